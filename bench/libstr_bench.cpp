@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libstr.h"
+#include "address.h"
+
+using namespace binary_file;
+
+namespace {
+	template<typename Function>
+	double time(Function&& function) {
+		const auto start{ std::chrono::steady_clock::now() };
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::string makeText(size_t size) {
+		static constexpr std::string_view pieces[]{
+			"$01:8000", "0x7FFF", "$0AF000", "  ", "\t", "\r\n", "label_name", "_x", ",", "; comment", "\xC3\xA9"
+		};
+
+		std::mt19937 random{ 0x5EED };
+		std::string text{};
+
+		while (text.size() < size) {
+			text += pieces[random() % std::size(pieces)];
+		}
+
+		return text;
+	}
+
+	bool checkConsistency() {
+		char block[32]{};
+		bool consistent{ true };
+
+		for (const auto cls : { char_class::space, char_class::digit, char_class::ualnum, char_class::xdigit }) {
+			for (unsigned c{ 0 }; c != 256; ++c) {
+				block[c % 32] = static_cast<char>(c);
+
+				if (c % 32 == 31) {
+					const auto mask{ class_mask32(block, cls) };
+
+					for (unsigned i{ 0 }; i != 32; ++i) {
+						if (((mask >> i) & 1) != is_class(block[i], cls)) {
+							std::printf("class 0x%02X disagrees with char_props on 0x%02X\n", static_cast<unsigned>(cls), c - 31 + i);
+							consistent = false;
+						}
+					}
+				}
+			}
+		}
+
+		const auto parsed{ Address::parse(" $01:8000 ", Mapper::LO_ROM) };
+		if (!parsed.has_value() || parsed->snes() != 0x018000 || Address::parse("0x7FFF", Mapper::LO_ROM)->pc() != 0x7FFF) {
+			std::printf("address literal parsing is broken\n");
+			consistent = false;
+		}
+
+		return consistent;
+	}
+}
+
+int main() {
+	if (!checkConsistency()) {
+		return 1;
+	}
+
+	const auto text{ makeText(64 << 20) };
+	const auto begin{ text.data() };
+	const auto end{ text.data() + text.size() };
+
+	size_t scalar_tokens{ 0 };
+	const auto scalar_time{ time([&] {
+		for (auto position{ begin }; position != end;) {
+			while (position != end && is_space(*position)) {
+				++position;
+			}
+
+			const auto token{ position };
+			while (position != end && !is_space(*position)) {
+				++position;
+			}
+
+			scalar_tokens += position != token;
+		}
+	}) };
+
+	size_t vector_tokens{ 0 };
+	const auto vector_time{ time([&] {
+		for (auto position{ begin }; position != end;) {
+			position = skip_space(position, end);
+
+			const auto token{ position };
+			position = find_space(position, end);
+
+			vector_tokens += position != token;
+		}
+	}) };
+
+	size_t parsed_addresses{ 0 };
+	const auto parse_time{ time([&] {
+		for (size_t i{ 0 }; i != 1000000; ++i) {
+			parsed_addresses += Address::parse(i % 2 ? "$01:8000" : "0x7FFF", Mapper::LO_ROM).has_value();
+		}
+	}) };
+
+	std::printf("tokenizing %zu MiB: is_space %.2f ms, skip_space/find_space %.2f ms (%zu/%zu tokens)\n",
+		text.size() >> 20, scalar_time, vector_time, scalar_tokens, vector_tokens);
+	std::printf("parsing 1M address literals: %.2f ms\n", parse_time);
+
+	return scalar_tokens == vector_tokens && parsed_addresses == 1000000 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "symbol_table.h"
+
+using namespace binary_file;
+
+namespace fs = std::filesystem;
+
+namespace {
+	template<typename Function>
+	double time(Function&& function) {
+		const auto start{ std::chrono::steady_clock::now() };
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// a WLA file the way asar writes it, with the last thousand labels defining earlier ones again,
+	// returns the name of the last label
+	std::string writeSymbolFile(const fs::path& path, size_t label_count) {
+		std::mt19937 random{ 0x5EED };
+		std::ofstream file{ path, std::ios::binary };
+
+		file << "; wla symbolic information file\n; generated by asar\n\n[labels]\n";
+
+		char line[96]{};
+		char name[48]{};
+
+		for (size_t label{ 0 }; label != label_count; ++label) {
+			const auto bank{ 0x80 + random() % 0x40 };
+			const auto offset{ 0x8000 + random() % 0x8000 };
+			const auto name_length{ random() % 20 };
+
+			std::snprintf(name, sizeof(name), "label_%zu_%.*s", label % (label_count - 1000),
+				static_cast<int>(name_length), "xxxxxxxxxxxxxxxxxxxx");
+			std::snprintf(line, sizeof(line), "%02X:%04X %s\n", static_cast<unsigned>(bank),
+				static_cast<unsigned>(offset), name);
+			file << line;
+		}
+
+		file << "\n[source files]\n0000 0123abcd main.asm\n\n[addr-to-line mapping]\n80:8000 0000:00000001\n";
+
+		return name;
+	}
+}
+
+int main() {
+	constexpr size_t label_count{ 500000 };
+	constexpr size_t runs{ 7 };
+
+	const auto path{ fs::temp_directory_path() / "binary_file_symbol_table_bench.sym" };
+	const auto last_label{ writeSymbolFile(path, label_count) };
+
+	std::vector<double> times{};
+	size_t size{ 0 };
+	bool found{ false };
+
+	for (size_t run{ 0 }; run != runs; ++run) {
+		times.push_back(time([&] {
+			const SymbolTable table{ path };
+
+			size = table.getSize();
+			found = table.find(last_label).has_value();
+		}));
+	}
+
+	fs::remove(path);
+
+	if (size != label_count || !found) {
+		std::printf("loaded %zu of %zu labels\n", size, label_count);
+		return 1;
+	}
+
+	std::sort(times.begin(), times.end());
+
+	std::printf("loading %zu labels: best %.2f ms, median %.2f ms, worst %.2f ms\n",
+		label_count, times.front(), times[runs / 2], times.back());
+
+	return 0;
+}
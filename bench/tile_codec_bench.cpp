@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "tile_codec.h"
+
+using namespace binary_file;
+
+namespace {
+	template<typename Function>
+	double time(Function&& function) {
+		const auto start{ std::chrono::steady_clock::now() };
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::vector<byte> makeBytes(size_t size) {
+		std::mt19937 random{ 0x5EED };
+		std::vector<byte> bytes(size);
+
+		for (auto& value : bytes) {
+			value = static_cast<byte>(random());
+		}
+
+		return bytes;
+	}
+
+	const char* nameOf(TileFormat format) {
+		switch (format) {
+		case TileFormat::BPP2:
+			return "2bpp";
+
+		case TileFormat::BPP4:
+			return "4bpp";
+
+		case TileFormat::BPP8:
+		default:
+			return "8bpp";
+		}
+	}
+
+	// the vector codec has to agree with the scalar reference on every pixel of random tiles, and
+	// pixels with bits above the depth have to encode as if those bits were clear
+	bool checkConsistency(TileFormat format) {
+		constexpr size_t tile_count{ 0x1000 };
+
+		const auto planar{ makeBytes(tile_count * tileSize(format)) };
+		const auto pixels{ makeBytes(tile_count * pixels_per_tile) };
+
+		std::vector<byte> decoded(pixels.size());
+		std::vector<byte> reference_decoded(pixels.size());
+		std::vector<byte> encoded(planar.size());
+		std::vector<byte> reference_encoded(planar.size());
+
+		decodeTiles(format, planar, decoded);
+		detail::decodeTilesScalar(format, planar, reference_decoded);
+		encodeTiles(format, pixels, encoded);
+		detail::encodeTilesScalar(format, pixels, reference_encoded);
+
+		bool consistent{ true };
+
+		if (decoded != reference_decoded) {
+			std::printf("%s decoding disagrees with the scalar reference\n", nameOf(format));
+			consistent = false;
+		}
+
+		if (encoded != reference_encoded) {
+			std::printf("%s encoding disagrees with the scalar reference\n", nameOf(format));
+			consistent = false;
+		}
+
+		std::vector<byte> round_trip(planar.size());
+		encodeTiles(format, decoded, round_trip);
+
+		if (round_trip != planar) {
+			std::printf("%s tiles don't survive decoding and encoding again\n", nameOf(format));
+			consistent = false;
+		}
+
+		return consistent;
+	}
+}
+
+int main() {
+	bool consistent{ true };
+
+	for (const auto format : { TileFormat::BPP2, TileFormat::BPP4, TileFormat::BPP8 }) {
+		consistent = checkConsistency(format) && consistent;
+	}
+
+	if (!consistent) {
+		return 1;
+	}
+
+	constexpr size_t tile_count{ 0x40000 };
+
+	for (const auto format : { TileFormat::BPP2, TileFormat::BPP4, TileFormat::BPP8 }) {
+		const auto planar{ makeBytes(tile_count * tileSize(format)) };
+		std::vector<byte> pixels(tile_count * pixels_per_tile);
+
+		const auto scalar_time{ time([&] { detail::decodeTilesScalar(format, planar, pixels); }) };
+		const auto vector_time{ time([&] { decodeTiles(format, planar, pixels); }) };
+
+		std::printf("decoding %zu %s tiles: scalar %.2f ms, decodeTiles %.2f ms\n",
+			tile_count, nameOf(format), scalar_time, vector_time);
+	}
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+#include "file_glob.h"
+
+#include <algorithm>
+#include <string>
+
+namespace binary_file::cli {
+	namespace {
+		bool hasWildcard(std::string_view text) {
+			return text.find_first_of("*?[") != std::string_view::npos;
+		}
+
+		bool isSeparator(char c) {
+			return c == '/' || c == '\\';
+		}
+
+		std::vector<std::string_view> splitComponents(std::string_view path) {
+			std::vector<std::string_view> components{};
+
+			while (!path.empty()) {
+				const auto separator{ std::find_if(path.begin(), path.end(), isSeparator) - path.begin() };
+
+				if (separator != 0) {
+					components.push_back(path.substr(0, separator));
+				}
+
+				path.remove_prefix(std::min<size_t>(separator + 1, path.size()));
+			}
+
+			return components;
+		}
+
+		// returns the position after the class or npos if it is malformed, matched says whether c is in it
+		size_t matchClass(std::string_view pattern, size_t position, char c, bool& matched) {
+			const auto negated{ position < pattern.size() && (pattern[position] == '!' || pattern[position] == '^') };
+			position += negated;
+
+			matched = false;
+			for (auto first{ true }; position < pattern.size() && (first || pattern[position] != ']'); first = false) {
+				const auto low{ pattern[position] };
+
+				if (position + 2 < pattern.size() && pattern[position + 1] == '-' && pattern[position + 2] != ']') {
+					matched |= low <= c && c <= pattern[position + 2];
+					position += 3;
+				}
+				else {
+					matched |= low == c;
+					++position;
+				}
+			}
+
+			if (position >= pattern.size()) {
+				return std::string_view::npos;
+			}
+
+			matched ^= negated;
+			return position + 1;
+		}
+
+		void walk(const fs::path& directory, const std::vector<std::string_view>& components, size_t component,
+			std::vector<fs::path>& matches) {
+			std::error_code error{};
+			const auto last{ component + 1 == components.size() };
+			const auto pattern{ components[component] };
+
+			if (pattern == "**") {
+				if (last) {
+					for (fs::recursive_directory_iterator it{ directory, error }, end{}; !error && it != end; it.increment(error)) {
+						if (it->is_regular_file(error)) {
+							matches.push_back(it->path());
+						}
+					}
+					return;
+				}
+
+				walk(directory, components, component + 1, matches);
+
+				for (fs::directory_iterator it{ directory, error }, end{}; !error && it != end; it.increment(error)) {
+					if (it->is_directory(error) && !it->is_symlink(error)) {
+						walk(it->path(), components, component, matches);
+					}
+				}
+				return;
+			}
+
+			if (!hasWildcard(pattern)) {
+				const auto child{ directory / std::string(pattern) };
+
+				if (last ? fs::is_regular_file(child, error) : fs::is_directory(child, error)) {
+					if (last) {
+						matches.push_back(child);
+					}
+					else {
+						walk(child, components, component + 1, matches);
+					}
+				}
+				return;
+			}
+
+			for (fs::directory_iterator it{ directory, error }, end{}; !error && it != end; it.increment(error)) {
+				if (!globMatches(it->path().filename().string(), pattern)) {
+					continue;
+				}
+
+				if (last && it->is_regular_file(error)) {
+					matches.push_back(it->path());
+				}
+				else if (!last && it->is_directory(error)) {
+					walk(it->path(), components, component + 1, matches);
+				}
+			}
+		}
+	}
+
+	bool globMatches(std::string_view name, std::string_view pattern) {
+		size_t name_position{ 0 };
+		size_t pattern_position{ 0 };
+
+		// where to resume after the last "*" if the rest fails to match
+		auto star{ std::string_view::npos };
+		size_t star_name{ 0 };
+
+		while (name_position != name.size()) {
+			if (pattern_position != pattern.size()) {
+				const auto c{ pattern[pattern_position] };
+
+				if (c == '*') {
+					star = ++pattern_position;
+					star_name = name_position;
+					continue;
+				}
+
+				if (c == '?') {
+					++pattern_position;
+					++name_position;
+					continue;
+				}
+
+				if (c == '[') {
+					bool matched{};
+					const auto next{ matchClass(pattern, pattern_position + 1, name[name_position], matched) };
+
+					if (next != std::string_view::npos) {
+						if (matched) {
+							pattern_position = next;
+							++name_position;
+							continue;
+						}
+					}
+					else if (name[name_position] == '[') {
+						++pattern_position;
+						++name_position;
+						continue;
+					}
+				}
+				else if (c == name[name_position]) {
+					++pattern_position;
+					++name_position;
+					continue;
+				}
+			}
+
+			if (star == std::string_view::npos) {
+				return false;
+			}
+
+			pattern_position = star;
+			name_position = ++star_name;
+		}
+
+		while (pattern_position != pattern.size() && pattern[pattern_position] == '*') {
+			++pattern_position;
+		}
+
+		return pattern_position == pattern.size();
+	}
+
+	std::vector<fs::path> expandGlob(std::string_view pattern) {
+		if (!hasWildcard(pattern)) {
+			return { fs::path(std::string(pattern)) };
+		}
+
+		const auto components{ splitComponents(pattern) };
+		const auto first_wildcard{ static_cast<size_t>(std::find_if(components.begin(), components.end(), hasWildcard) - components.begin()) };
+
+		fs::path base{};
+		if (!pattern.empty() && isSeparator(pattern.front())) {
+			base = "/";
+		}
+
+		for (size_t component{ 0 }; component != first_wildcard; ++component) {
+			base /= std::string(components[component]);
+		}
+
+		std::vector<std::string_view> rest(components.begin() + first_wildcard, components.end());
+		std::vector<fs::path> matches{};
+
+		walk(base.empty() ? fs::path(".") : base, rest, 0, matches);
+
+		// "./" would otherwise prefix every match of a relative pattern
+		if (base.empty()) {
+			for (auto& match : matches) {
+				match = match.lexically_relative(".");
+			}
+		}
+
+		std::sort(matches.begin(), matches.end());
+		return matches;
+	}
+}
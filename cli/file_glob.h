@@ -0,0 +1,18 @@
+#ifndef FILE_GLOB_H
+#define FILE_GLOB_H
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace binary_file::cli {
+	// "*", "?" and "[...]" ("[!...]" negates) match within one path component, a "**" component
+	// matches any number of directories, arguments without wildcards are returned as they are so a
+	// missing file is reported when it is opened
+	bool globMatches(std::string_view name, std::string_view pattern);
+	std::vector<fs::path> expandGlob(std::string_view pattern);
+}
+
+#endif // FILE_GLOB_H
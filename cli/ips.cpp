@@ -0,0 +1,120 @@
+#include "ips.h"
+
+#include <algorithm>
+#include <string_view>
+
+namespace binary_file::cli {
+	namespace {
+		constexpr std::string_view header{ "PATCH" };
+		constexpr std::string_view footer{ "EOF" };
+		// a record at this offset would read as the footer
+		constexpr size_t footer_offset{ 0x454F46 };
+		constexpr size_t max_offset{ 0xFFFFFF };
+		constexpr size_t max_record_size{ 0xFFFF };
+
+		size_t readBigEndian(std::span<const byte> patch, size_t& position, size_t byte_count) {
+			if (patch.size() - position < byte_count) {
+				throw IpsException(fmt::format(
+					"IPS patch ends in the middle of a record at 0x{:X}",
+					position
+				));
+			}
+
+			size_t value{ 0 };
+			for (size_t i{ 0 }; i != byte_count; ++i) {
+				value = value << 8 | patch[position++];
+			}
+
+			return value;
+		}
+
+		void appendBigEndian(std::vector<byte>& patch, size_t value, size_t byte_count) {
+			for (size_t i{ byte_count }; i-- != 0;) {
+				patch.push_back((value >> (i * 8)) & 0xFF);
+			}
+		}
+	}
+
+	void applyIps(std::span<const byte> patch, std::vector<byte>& target) {
+		if (patch.size() < header.size() || !std::equal(header.begin(), header.end(), patch.begin())) {
+			throw IpsException("Not an IPS patch, it doesn't start with \"PATCH\"");
+		}
+
+		size_t position{ header.size() };
+
+		while (true) {
+			if (patch.size() - position >= footer.size() &&
+				std::equal(footer.begin(), footer.end(), patch.begin() + position)) {
+				position += footer.size();
+				break;
+			}
+
+			const auto offset{ readBigEndian(patch, position, 3) };
+			const auto size{ readBigEndian(patch, position, 2) };
+
+			if (size == 0) {
+				const auto run{ readBigEndian(patch, position, 2) };
+				const auto value{ static_cast<byte>(readBigEndian(patch, position, 1)) };
+
+				target.resize(std::max(target.size(), offset + run));
+				std::fill_n(target.begin() + offset, run, value);
+			}
+			else {
+				if (patch.size() - position < size) {
+					throw IpsException(fmt::format(
+						"IPS record at 0x{:X} wants 0x{:X} byte(s), but the patch ends first",
+						position - 5, size
+					));
+				}
+
+				target.resize(std::max(target.size(), offset + size));
+				std::copy_n(patch.begin() + position, size, target.begin() + offset);
+				position += size;
+			}
+		}
+
+		if (patch.size() - position >= 3) {
+			target.resize(readBigEndian(patch, position, 3));
+		}
+	}
+
+	std::vector<byte> createIps(std::span<const byte> base, std::span<const byte> modified,
+		const std::vector<DiffRange>& ranges) {
+		std::vector<byte> patch(header.begin(), header.end());
+
+		for (const auto& range : ranges) {
+			auto offset{ range.offset };
+			const auto end{ std::min(range.offset + range.length, modified.size()) };
+
+			while (offset < end) {
+				// backing up one byte keeps the record from looking like the footer
+				if (offset == footer_offset) {
+					--offset;
+				}
+
+				if (offset > max_offset) {
+					throw IpsException(fmt::format(
+						"Difference at 0x{:X} is past the 16 MiB IPS patches can address",
+						offset
+					));
+				}
+
+				const auto size{ std::min(end - offset, max_record_size) };
+
+				appendBigEndian(patch, offset, 3);
+				appendBigEndian(patch, size, 2);
+				patch.insert(patch.end(), modified.begin() + offset, modified.begin() + offset + size);
+
+				offset += size;
+			}
+		}
+
+		patch.insert(patch.end(), footer.begin(), footer.end());
+
+		if (modified.size() < base.size()) {
+			appendBigEndian(patch, modified.size(), 3);
+		}
+
+		return patch;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef IPS_H
+#define IPS_H
+
+#include <span>
+#include <vector>
+
+#include "binary_file.h"
+#include "diff.h"
+
+namespace binary_file::cli {
+	class IpsException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	// applies an IPS patch, RLE records and the truncation extension included, records past the end
+	// of target grow it with zeroes
+	void applyIps(std::span<const byte> patch, std::vector<byte>& target);
+
+	// an IPS patch turning base into modified, ranges as returned by diff for the two
+	std::vector<byte> createIps(std::span<const byte> base, std::span<const byte> modified,
+		const std::vector<DiffRange>& ranges);
+}
+
+#endif // IPS_H
@@ -0,0 +1,72 @@
+#ifndef JSON_LINE_H
+#define JSON_LINE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "fmt/format.h"
+
+namespace binary_file::cli {
+	// One JSON object built field by field and printed as a single line. Strings are copied byte for
+	// byte apart from the required escapes, unless ascii_only is set, then anything outside printable
+	// ASCII is escaped as if it were Latin-1, for header titles that may be Shift-JIS.
+	class JsonLine {
+	public:
+		static std::string quote(std::string_view text, bool ascii_only = false) {
+			std::string quoted{ "\"" };
+
+			for (const auto c : text) {
+				const auto value{ static_cast<unsigned char>(c) };
+
+				if (c == '"' || c == '\\') {
+					quoted += '\\';
+					quoted += c;
+				}
+				else if (value < 0x20 || (ascii_only && value >= 0x7F)) {
+					quoted += fmt::format("\\u{:04x}", value);
+				}
+				else {
+					quoted += c;
+				}
+			}
+
+			return quoted + '"';
+		}
+
+		JsonLine& addString(std::string_view key, std::string_view value, bool ascii_only = false) {
+			return addRaw(key, quote(value, ascii_only));
+		}
+
+		JsonLine& addNumber(std::string_view key, uint64_t value) {
+			return addRaw(key, fmt::format("{}", value));
+		}
+
+		JsonLine& addBool(std::string_view key, bool value) {
+			return addRaw(key, value ? "true" : "false");
+		}
+
+		// hashes go out as fixed width hex strings, JSON numbers lose precision past 2^53
+		JsonLine& addHex(std::string_view key, uint64_t value, size_t digits) {
+			return addRaw(key, fmt::format("\"{:0{}x}\"", value, digits));
+		}
+
+		// value must already be valid JSON
+		JsonLine& addRaw(std::string_view key, std::string_view value) {
+			text += text.size() == 1 ? "" : ",";
+			text += quote(key);
+			text += ':';
+			text += value;
+			return *this;
+		}
+
+		std::string finish() const {
+			return text + "}\n";
+		}
+
+	private:
+		std::string text{ "{" };
+	};
+}
+
+#endif // JSON_LINE_H
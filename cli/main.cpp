@@ -0,0 +1,475 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "rom.h"
+#include "diff.h"
+#include "hash.h"
+#include "file_glob.h"
+#include "ips.h"
+#include "json_line.h"
+#include "work_pool.h"
+
+using namespace binary_file;
+using namespace binary_file::cli;
+
+namespace {
+	constexpr std::string_view usage{
+		"usage: binary-file-cli <command> [options] <file|glob>...\n"
+		"\n"
+		"commands:\n"
+		"  info            mapper and internal header of each rom\n"
+		"  hash            CRC-32 and XXH64 of each file\n"
+		"  usage           what each 32 KiB block of each rom holds, per SNES bank\n"
+		"  diff <base>     ranges in which each file differs from base\n"
+		"  patch <patch>   applies an IPS patch to each file\n"
+		"\n"
+		"options:\n"
+		"  -j, --jobs <n>          worker threads, defaults to one per hardware thread\n"
+		"  --files-from <file>     also process the paths listed in file, one per line, - for stdin\n"
+		"  --merge-gap <n>         diff: report ranges at most n equal bytes apart as one\n"
+		"  --ips <directory>       diff: also write <file name>.ips turning base into each file\n"
+		"  --output <directory>    patch: write the patched files to directory\n"
+		"  --in-place              patch: overwrite the input files instead\n"
+		"  --histograms            usage: include each block's byte histogram\n"
+		"  --no-timings            don't print the per-stage timings to stderr\n"
+		"\n"
+		"Each file produces one JSON object per line on stdout, in the order files finish, files that\n"
+		"fail carry an \"error\" field instead of results. Globs support *, ?, [...] and ** and are\n"
+		"expanded here, so quote them to get past shells with argument limits.\n"
+	};
+
+	class UsageException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	enum class Stage {
+		EXPAND,
+		LOAD,
+		PROCESS,
+		OUTPUT
+	};
+
+	constexpr std::array<std::string_view, 4> stage_names{ "expand", "load", "process", "output" };
+
+	// time spent in each stage summed over all workers, so the stages of a parallel run add up to
+	// more than the wall time
+	class StageTimes {
+	public:
+		template<typename Function>
+		decltype(auto) time(Stage stage, Function&& function) {
+			const Timer timer{ *this, stage };
+			return function();
+		}
+
+		void print(double wall_ms, size_t files, size_t failed, uint64_t bytes) const {
+			std::fprintf(stderr, "%-8s %8s %12s %10s\n", "stage", "calls", "total ms", "mean ms");
+
+			for (size_t stage{ 0 }; stage != stage_names.size(); ++stage) {
+				const auto calls{ stages[stage].calls.load() };
+				const auto total_ms{ stages[stage].nanoseconds.load() / 1e6 };
+
+				std::fprintf(stderr, "%-8s %8llu %12.2f %10.3f\n", stage_names[stage].data(),
+					static_cast<unsigned long long>(calls), total_ms, calls == 0 ? 0.0 : total_ms / calls);
+			}
+
+			std::fprintf(stderr, "%zu file(s), %zu failed, %.1f MiB in %.2f ms wall (%.1f MiB/s)\n",
+				files, failed, bytes / 1048576.0, wall_ms, wall_ms == 0 ? 0.0 : bytes / 1048576.0 / (wall_ms / 1e3));
+		}
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct Totals {
+			std::atomic<uint64_t> nanoseconds{ 0 };
+			std::atomic<uint64_t> calls{ 0 };
+		};
+
+		class Timer {
+		public:
+			Timer(StageTimes& times, Stage stage) : totals(times.stages[static_cast<size_t>(stage)]) {}
+
+			~Timer() {
+				totals.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+				++totals.calls;
+			}
+
+		private:
+			Totals& totals;
+			clock::time_point start{ clock::now() };
+		};
+
+		std::array<Totals, stage_names.size()> stages{};
+	};
+
+	struct Options {
+		std::string command{};
+		std::optional<fs::path> input{};
+		std::vector<std::string> patterns{};
+		std::optional<std::string> files_from{};
+		size_t jobs{ std::max<size_t>(std::thread::hardware_concurrency(), 1) };
+		size_t merge_gap{ 0 };
+		std::optional<fs::path> ips_directory{};
+		std::optional<fs::path> output_directory{};
+		bool in_place{ false };
+		bool histograms{ false };
+		bool timings{ true };
+	};
+
+	size_t parseCount(std::string_view option, const std::string& text) {
+		try {
+			size_t used{ 0 };
+			const auto value{ std::stoull(text, &used, 0) };
+
+			if (used == text.size()) {
+				return value;
+			}
+		}
+		catch (const std::exception&) {}
+
+		throw UsageException(fmt::format("{} needs a number, not '{}'", option, text));
+	}
+
+	Options parseOptions(int argc, char** argv) {
+		Options options{};
+		std::vector<std::string> arguments(argv + 1, argv + argc);
+
+		const auto value{ [&](size_t& i) -> const std::string& {
+			if (i + 1 == arguments.size()) {
+				throw UsageException(fmt::format("{} needs a value", arguments[i]));
+			}
+
+			return arguments[++i];
+		} };
+
+		for (size_t i{ 0 }; i != arguments.size(); ++i) {
+			const auto& argument{ arguments[i] };
+
+			if (argument == "-j" || argument == "--jobs") {
+				options.jobs = std::max<size_t>(parseCount(argument, value(i)), 1);
+			}
+			else if (argument == "--files-from") {
+				options.files_from = value(i);
+			}
+			else if (argument == "--merge-gap") {
+				options.merge_gap = parseCount(argument, value(i));
+			}
+			else if (argument == "--ips") {
+				options.ips_directory = value(i);
+			}
+			else if (argument == "--output") {
+				options.output_directory = value(i);
+			}
+			else if (argument == "--in-place") {
+				options.in_place = true;
+			}
+			else if (argument == "--histograms") {
+				options.histograms = true;
+			}
+			else if (argument == "--no-timings") {
+				options.timings = false;
+			}
+			else if (argument.size() > 1 && argument.front() == '-') {
+				throw UsageException(fmt::format("Unknown option {}", argument));
+			}
+			else if (options.command.empty()) {
+				options.command = argument;
+			}
+			else if ((options.command == "diff" || options.command == "patch") && !options.input.has_value()) {
+				options.input = argument;
+			}
+			else {
+				options.patterns.push_back(argument);
+			}
+		}
+
+		if (options.command != "info" && options.command != "hash" && options.command != "usage" &&
+			options.command != "diff" && options.command != "patch") {
+			throw UsageException(options.command.empty() ? "No command given" : fmt::format("Unknown command {}", options.command));
+		}
+
+		if ((options.command == "diff" || options.command == "patch") && !options.input.has_value()) {
+			throw UsageException(fmt::format("{} needs a {} file", options.command, options.command == "diff" ? "base" : "patch"));
+		}
+
+		if (options.command == "patch" && options.in_place == options.output_directory.has_value()) {
+			throw UsageException("patch needs exactly one of --output and --in-place");
+		}
+
+		if (options.patterns.empty() && !options.files_from.has_value()) {
+			throw UsageException("No files given");
+		}
+
+		return options;
+	}
+
+	std::vector<fs::path> collectFiles(const Options& options) {
+		std::vector<fs::path> files{};
+
+		for (const auto& pattern : options.patterns) {
+			auto matches{ expandGlob(pattern) };
+
+			if (matches.empty()) {
+				std::fprintf(stderr, "warning: %s matches no files\n", pattern.c_str());
+			}
+
+			files.insert(files.end(), matches.begin(), matches.end());
+		}
+
+		if (options.files_from.has_value()) {
+			std::ifstream list_file{};
+			if (options.files_from.value() != "-") {
+				list_file.open(options.files_from.value());
+
+				if (!list_file) {
+					throw UsageException(fmt::format("Failed to open file list {}", options.files_from.value()));
+				}
+			}
+
+			auto& list{ options.files_from.value() == "-" ? std::cin : list_file };
+
+			for (std::string line{}; std::getline(list, line);) {
+				if (!line.empty() && line.back() == '\r') {
+					line.pop_back();
+				}
+
+				if (!line.empty()) {
+					files.emplace_back(line);
+				}
+			}
+		}
+
+		return files;
+	}
+
+	// what the commands share, loaded once before the workers start
+	struct Context {
+		const Options& options;
+		StageTimes& times;
+		std::optional<BinaryFile> input{};
+	};
+
+	JsonLine info(Context& context, const fs::path& path) {
+		auto rom{ context.times.time(Stage::LOAD, [&] { return Rom(path); }) };
+
+		return context.times.time(Stage::PROCESS, [&] {
+			rom.ensureMapper();
+
+			const auto mapper{ rom.getMapper().value() };
+			const auto header{ rom.getHeader() };
+
+			JsonLine line{};
+			line.addString("path", path.string())
+				.addNumber("size", rom.getSize())
+				.addString("mapper", mapperName(mapper));
+
+			if (mapper == Mapper::SA1_ROM) {
+				const auto banks{ rom.getSa1Banks() };
+				line.addRaw("sa1_banks", fmt::format("[{},{},{},{}]", banks.block(0), banks.block(1), banks.block(2), banks.block(3)));
+			}
+
+			return line.addString("title", header.title, true)
+				.addNumber("map_mode", header.map_mode)
+				.addNumber("rom_type", header.rom_type)
+				.addNumber("rom_size", header.rom_size)
+				.addNumber("sram_size", header.sram_size)
+				.addNumber("region", header.region)
+				.addNumber("developer", header.developer)
+				.addNumber("version", header.version)
+				.addHex("checksum", header.checksum, 4)
+				.addHex("checksum_complement", header.checksum_complement, 4)
+				.addBool("checksum_pair_valid", (header.checksum ^ header.checksum_complement) == 0xFFFF);
+		});
+	}
+
+	JsonLine hash(Context& context, const fs::path& path) {
+		const auto file{ context.times.time(Stage::LOAD, [&] { return BinaryFile(path); }) };
+
+		return context.times.time(Stage::PROCESS, [&] {
+			const auto view{ file.getView() };
+
+			JsonLine line{};
+			return line.addString("path", path.string())
+				.addNumber("size", view.size())
+				.addHex("crc32", crc32(view), 8)
+				.addHex("xxh64", hash64(view), 16);
+		});
+	}
+
+	JsonLine usageMap(Context& context, const fs::path& path) {
+		auto rom{ context.times.time(Stage::LOAD, [&] { return Rom(path); }) };
+		const auto usage_map{ context.times.time(Stage::PROCESS, [&] { return rom.analyzeUsage(); }) };
+
+		return context.times.time(Stage::OUTPUT, [&] {
+			JsonLine line{};
+			return line.addString("path", path.string())
+				.addNumber("size", rom.getSize())
+				.addRaw("usage", usage_map.toJson(context.options.histograms));
+		});
+	}
+
+	JsonLine diffAgainst(Context& context, const fs::path& path) {
+		const auto& base{ context.input.value() };
+		const auto file{ context.times.time(Stage::LOAD, [&] { return BinaryFile(path); }) };
+		const auto ranges{ context.times.time(Stage::PROCESS, [&] { return diff(base, file, context.options.merge_gap); }) };
+
+		return context.times.time(Stage::OUTPUT, [&] {
+			size_t differing{ 0 };
+			std::string range_list{ "[" };
+
+			for (const auto& range : ranges) {
+				range_list += fmt::format("{}[{},{}]", range_list.size() == 1 ? "" : ",", range.offset, range.length);
+				differing += range.length;
+			}
+
+			JsonLine line{};
+			line.addString("path", path.string())
+				.addNumber("size", file.getSize())
+				.addNumber("differing_bytes", differing)
+				.addNumber("range_count", ranges.size())
+				.addRaw("ranges", range_list + "]");
+
+			if (context.options.ips_directory.has_value()) {
+				const auto ips_path{ context.options.ips_directory.value() / (path.filename().string() + ".ips") };
+				BinaryFile(createIps(base.getView(), file.getView(), ranges)).outputAt(ips_path);
+
+				line.addString("ips", ips_path.string());
+			}
+
+			return line;
+		});
+	}
+
+	JsonLine patch(Context& context, const fs::path& path) {
+		const auto file{ context.times.time(Stage::LOAD, [&] { return BinaryFile(path); }) };
+
+		auto patched{ context.times.time(Stage::PROCESS, [&] {
+			const auto view{ file.getView() };
+			std::vector<byte> bytes(view.begin(), view.end());
+
+			applyIps(context.input->getView(), bytes);
+			return BinaryFile(std::move(bytes));
+		}) };
+
+		return context.times.time(Stage::OUTPUT, [&] {
+			const auto output_path{ context.options.in_place ? path : context.options.output_directory.value() / path.filename() };
+			patched.outputAt(output_path);
+
+			JsonLine line{};
+			return line.addString("path", path.string())
+				.addString("output", output_path.string())
+				.addNumber("size_before", file.getSize())
+				.addNumber("size_after", patched.getSize())
+				.addHex("crc32", crc32(patched.getView()), 8);
+		});
+	}
+
+	int run(const Options& options) {
+		const auto start{ std::chrono::steady_clock::now() };
+
+		StageTimes times{};
+		Context context{ options, times };
+
+		const auto files{ times.time(Stage::EXPAND, [&] { return collectFiles(options); }) };
+
+		if (options.input.has_value()) {
+			context.input.emplace(times.time(Stage::LOAD, [&] { return BinaryFile(options.input.value()); }));
+		}
+
+		for (const auto& directory : { options.ips_directory, options.output_directory }) {
+			if (directory.has_value()) {
+				fs::create_directories(directory.value());
+			}
+		}
+
+		// two inputs with the same name would silently overwrite each other's output
+		if (options.ips_directory.has_value() || options.output_directory.has_value()) {
+			std::set<fs::path> names{};
+
+			for (const auto& file : files) {
+				if (!names.insert(file.filename()).second) {
+					throw UsageException(fmt::format(
+						"More than one input is named {}, their outputs would collide",
+						file.filename().string()
+					));
+				}
+			}
+		}
+
+		const auto command{
+			options.command == "info" ? info :
+			options.command == "hash" ? hash :
+			options.command == "usage" ? usageMap :
+			options.command == "diff" ? diffAgainst : patch
+		};
+
+		std::mutex output_mutex{};
+		std::atomic<size_t> failed{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+
+		WorkPool(options.jobs).run(files.size(), [&](size_t index) {
+			const auto& path{ files[index] };
+			std::string text{};
+
+			try {
+				text = command(context, path).finish();
+
+				// file_size returns -1 on error, which would wrap the total
+				std::error_code error{};
+				const auto size{ fs::file_size(path, error) };
+
+				if (!error) {
+					bytes += size;
+				}
+			}
+			catch (const std::exception& exception) {
+				++failed;
+				text = JsonLine().addString("path", path.string()).addString("error", exception.what()).finish();
+			}
+
+			std::lock_guard lock{ output_mutex };
+			std::fwrite(text.data(), 1, text.size(), stdout);
+		});
+
+		std::fflush(stdout);
+
+		if (options.timings) {
+			const auto wall_ms{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+			times.print(wall_ms, files.size(), failed, bytes);
+		}
+
+		return failed == 0 ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	for (int i{ 1 }; i != argc; ++i) {
+		if (std::string_view(argv[i]) == "-h" || std::string_view(argv[i]) == "--help") {
+			std::fputs(usage.data(), stdout);
+			return 0;
+		}
+	}
+
+	try {
+		return run(parseOptions(argc, argv));
+	}
+	catch (const UsageException& exception) {
+		std::fprintf(stderr, "%s\n\n%s", exception.what(), usage.data());
+		return 2;
+	}
+	catch (const std::exception& exception) {
+		std::fprintf(stderr, "error: %s\n", exception.what());
+		return 1;
+	}
+}
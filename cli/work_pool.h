@@ -0,0 +1,127 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace binary_file::cli {
+	// Runs function(index) for every index in [0, count) on worker_count threads. Each worker starts
+	// with its own contiguous share and takes from the front of it, a worker that runs dry steals
+	// half of the largest remaining share from its back, so a few huge files don't leave every other
+	// thread idle. The first exception is rethrown once all workers stopped.
+	class WorkPool {
+	public:
+		WorkPool(size_t worker_count) : worker_count(std::max<size_t>(worker_count, 1)) {}
+
+		template<typename Function>
+		void run(size_t count, Function&& function) {
+			std::vector<Share> shares(std::min(worker_count, std::max<size_t>(count, 1)));
+
+			for (size_t index{ 0 }; index != count; ++index) {
+				shares[index * shares.size() / count].indices.push_back(index);
+			}
+
+			std::exception_ptr error{};
+			std::mutex error_mutex{};
+
+			const auto work{ [&](size_t worker) {
+				try {
+					while (const auto index{ take(shares, worker) }) {
+						function(index.value());
+					}
+				}
+				catch (...) {
+					std::lock_guard lock{ error_mutex };
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+			} };
+
+			std::vector<std::thread> threads{};
+			threads.reserve(shares.size() - 1);
+
+			for (size_t worker{ 1 }; worker != shares.size(); ++worker) {
+				threads.emplace_back(work, worker);
+			}
+
+			work(0);
+
+			for (auto& thread : threads) {
+				thread.join();
+			}
+
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+	private:
+		struct Share {
+			std::mutex mutex{};
+			std::deque<size_t> indices{};
+		};
+
+		size_t worker_count;
+
+		static std::optional<size_t> take(std::vector<Share>& shares, size_t worker) {
+			auto& own{ shares[worker] };
+
+			{
+				std::lock_guard lock{ own.mutex };
+				if (!own.indices.empty()) {
+					const auto index{ own.indices.front() };
+					own.indices.pop_front();
+					return index;
+				}
+			}
+
+			while (true) {
+				size_t victim{ worker };
+				size_t victim_size{ 0 };
+
+				for (size_t other{ 0 }; other != shares.size(); ++other) {
+					std::lock_guard lock{ shares[other].mutex };
+					if (shares[other].indices.size() > victim_size) {
+						victim = other;
+						victim_size = shares[other].indices.size();
+					}
+				}
+
+				if (victim_size == 0) {
+					return std::nullopt;
+				}
+
+				std::deque<size_t> stolen{};
+				{
+					std::lock_guard lock{ shares[victim].mutex };
+					auto& indices{ shares[victim].indices };
+
+					// it may have shrunk since it was measured
+					if (indices.empty()) {
+						continue;
+					}
+
+					const auto half{ (indices.size() + 1) / 2 };
+					stolen.assign(indices.end() - half, indices.end());
+					indices.erase(indices.end() - half, indices.end());
+				}
+
+				const auto index{ stolen.front() };
+				stolen.pop_front();
+
+				std::lock_guard lock{ own.mutex };
+				own.indices.insert(own.indices.end(), stolen.begin(), stolen.end());
+
+				return index;
+			}
+		}
+	};
+}
+
+#endif // WORK_POOL_H
@@ -1,16 +1,17 @@
 #ifndef ADDRESS_H
 #define ADDRESS_H
 
+#include <cstdint>
 #include <optional>
 #include <ostream>
+#include <string_view>
+#include <type_traits>
 
 #include "mapper.h"
 #include "exception.h"
 #include "fmt/format.h"
 
 namespace binary_file {
-	extern int sa1banks[8];//only 0, 1, 4, 5 are used
-
 	class MissingMapperException : public BinaryFileException {
 	public:
 		using BinaryFileException::BinaryFileException;
@@ -21,40 +22,46 @@ namespace binary_file {
 		using BinaryFileException::BinaryFileException;
 	};
 
+	// Packed into a single 64-bit word: 24-bit SNES address, 24-bit PC address, a validity bit for
+	// each and a 13-bit mapping tag (0 means no mapper, SA-1 tags carry the bank configuration).
+	// Whichever half can be derived from the other is computed on construction, so all accessors
+	// are const and copies are trivial.
 	class Address {
 	private:
-		std::optional<Mapper> mapper;
-
-		std::optional<size_t> pc_address;
-		std::optional<size_t> snes_address;
-
-		Address(size_t address, std::optional<Mapper> mapper, bool is_pc);
-
-		size_t pcToSnes(size_t pc_address);
-		size_t snesToPc(size_t snes_address);
-
-		size_t pcToLoRom(size_t pc_address);
-		size_t pcToHiRom(size_t pc_address);
-		size_t pcToExLoRom(size_t pc_address);
-		size_t pcToExHiRom(size_t pc_address);
-		size_t pcToSa1Rom(size_t pc_address);
-		size_t pcToBigSa1Rom(size_t pc_address);
-		size_t pcToSfxRom(size_t pc_address);
-		size_t pcToNoRom(size_t pc_address);
-
-		size_t loRomToPc(size_t snes_address);
-		size_t hiRomToPc(size_t snes_address);
-		size_t exLoRomToPc(size_t snes_address);
-		size_t exHiRomToPc(size_t snes_address);
-		size_t sa1RomToPc(size_t snes_address);
-		size_t bigSa1RomToPc(size_t snes_address);
-		size_t sfxRomToPc(size_t snes_address);
-		size_t noRomToPc(size_t snes_address);
-
-		void ensureSnesAddress();
-		void ensurePcAddress();
-
-		void updatePcFromSnes();
+		static constexpr uint64_t address_mask{ 0xFFFFFF };
+		static constexpr unsigned pc_shift{ 24 };
+		static constexpr uint64_t has_snes_bit{ uint64_t{ 1 } << 48 };
+		static constexpr uint64_t has_pc_bit{ uint64_t{ 1 } << 49 };
+		static constexpr unsigned mapping_shift{ 50 };
+		static constexpr uint64_t mapping_mask{ 0x1FFF };
+		static constexpr uint64_t sa1_mapping{ 9 };
+
+		uint64_t packed;
+
+		Address(size_t address, std::optional<Mapper> mapper, Sa1Banks sa1_banks, bool is_pc);
+
+		static uint64_t mappingOf(std::optional<Mapper> mapper, Sa1Banks sa1_banks);
+
+		static std::optional<size_t> pcToSnes(size_t pc_address, Mapper mapper, Sa1Banks sa1_banks);
+		static std::optional<size_t> snesToPc(size_t snes_address, Mapper mapper, Sa1Banks sa1_banks);
+
+		static std::optional<size_t> pcToLoRom(size_t pc_address);
+		static std::optional<size_t> pcToHiRom(size_t pc_address);
+		static std::optional<size_t> pcToExLoRom(size_t pc_address);
+		static std::optional<size_t> pcToExHiRom(size_t pc_address);
+		static std::optional<size_t> pcToSa1Rom(size_t pc_address, Sa1Banks sa1_banks);
+		static std::optional<size_t> pcToBigSa1Rom(size_t pc_address);
+		static std::optional<size_t> pcToSfxRom(size_t pc_address);
+		static std::optional<size_t> pcToNoRom(size_t pc_address);
+
+		static std::optional<size_t> loRomToPc(size_t snes_address);
+		static std::optional<size_t> hiRomToPc(size_t snes_address);
+		static std::optional<size_t> exLoRomToPc(size_t snes_address);
+		static std::optional<size_t> exHiRomToPc(size_t snes_address);
+		static std::optional<size_t> sa1RomToPc(size_t snes_address, Sa1Banks sa1_banks);
+		static std::optional<size_t> bigSa1RomToPc(size_t snes_address);
+		static std::optional<size_t> sfxRomToPc(size_t snes_address);
+		static std::optional<size_t> noRomToPc(size_t snes_address);
 
 		static void throwInvalidPcAddress(size_t pc_address);
 		static void throwInvalidSnesAddress(size_t snes_address);
@@ -63,15 +70,26 @@ namespace binary_file {
 		static Address PC(size_t pc_address);
 		static Address PC(size_t pc_address, Mapper mapper);
 		static Address SNES(size_t snes_address, Mapper mapper);
+		static Address PC(size_t pc_address, Mapper mapper, Sa1Banks sa1_banks);
+		static Address SNES(size_t snes_address, Mapper mapper, Sa1Banks sa1_banks);
+
+		// "$018000", "$01:8000", "01:8000" and "018000" are SNES addresses, "0x7FFF" is a PC address,
+		// surrounding whitespace is ignored and anything else gives nullopt
+		static std::optional<Address> parse(std::string_view text, Mapper mapper, Sa1Banks sa1_banks = Sa1Banks());
+
+		size_t pc() const;
+		size_t snes() const;
 
-		size_t pc();
-		size_t snes();
+		bool hasPc() const;
+		bool hasSnes() const;
+		std::optional<Mapper> getMapper() const;
+		Sa1Banks getSa1Banks() const;
 
 		Address& operator+=(const size_t rhs);
-		Address& operator-=(const size_t rhs);		
-		
-		Address operator+(const size_t rhs);
-		Address operator-(const size_t rhs);
+		Address& operator-=(const size_t rhs);
+
+		Address operator+(const size_t rhs) const;
+		Address operator-(const size_t rhs) const;
 
 		Address& operator++();
 		Address operator++(int);
@@ -79,12 +97,16 @@ namespace binary_file {
 		Address& operator--();
 		Address operator--(int);
 
-		std::string string();
+		bool operator==(const Address& rhs) const = default;
+
+		std::string string() const;
 
-		friend std::ostream& operator<<(std::ostream& target, Address& source);
+		friend std::ostream& operator<<(std::ostream& target, const Address& source);
 	};
 
-	std::ostream& operator<<(std::ostream& target, Address& source);
+	static_assert(sizeof(Address) == 8 && std::is_trivially_copyable_v<Address>);
+
+	std::ostream& operator<<(std::ostream& target, const Address& source);
 }
 
 #endif // ADDRESS_H
@@ -1,14 +1,21 @@
 #ifndef BINARY_FILE_H
 #define BINARY_FILE_H
 
+#include <array>
 #include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
 #include <utility>
 #include <optional>
+#include <span>
+#include <variant>
 #include <vector>
 #include <fstream>
 
 #include "fmt/format.h"
 #include "exception.h"
+#include "write_provenance.h"
 
 namespace fs = std::filesystem;
 
@@ -17,21 +24,76 @@ namespace binary_file {
     using _2bytes = uint16_t;
     using _4bytes = uint32_t;
 
+    // the owned contents of a BinaryFile, a std::vector adopted as it is or a std::pmr::vector
+    // allocated from a memory resource, with the parts of the std::vector interface the library uses
+    class ByteStorage {
+    public:
+        ByteStorage() = default;
+        ByteStorage(std::vector<byte>&& bytes);
+        ByteStorage(std::pmr::vector<byte>&& bytes);
+        // empty, grows from resource, nullptr means the global allocator
+        explicit ByteStorage(std::pmr::memory_resource* resource);
+
+        byte* data();
+        const byte* data() const;
+        size_t size() const;
+
+        byte* begin();
+        byte* end();
+        const byte* begin() const;
+        const byte* end() const;
+
+        byte& operator[](size_t index);
+        const byte& operator[](size_t index) const;
+
+        void resize(size_t new_size, byte fill = 0);
+        void assign(std::span<const byte> new_bytes);
+
+        // nullptr while the bytes come from the global allocator
+        std::pmr::memory_resource* getResource() const;
+
+    private:
+        std::variant<std::vector<byte>, std::pmr::vector<byte>> storage{};
+    };
+
     class BinaryFile {
     protected:
-        std::vector<byte> bytes;
+        ByteStorage bytes;
         const std::optional<fs::path> input_path;
 
-        static _4bytes join(const std::vector<byte>& bytes);
-        static std::vector<byte> split(_4bytes bytes, size_t byte_count);
+        // while set, the contents are the read-only shared_bytes kept alive by shared_owner and bytes
+        // is empty, the first write copies them into bytes
+        std::shared_ptr<const void> shared_owner{};
+        std::span<const byte> shared_bytes{};
 
+        std::optional<WriteProvenance> provenance{};
+
+        BinaryFile(const fs::path& path, std::shared_ptr<const void> shared_owner, std::span<const byte> shared_bytes);
+
+        ByteStorage& ownedBytes();
+        void replaceBytes(ByteStorage&& new_bytes);
+        // empty storage allocated the same way as the contents, for building their replacement
+        ByteStorage makeStorage() const;
+
+        static _4bytes join(std::span<const byte> bytes);
+        static _4bytes join(std::initializer_list<byte> bytes);
+        static std::array<byte, sizeof(_4bytes)> split(_4bytes bytes, size_t byte_count);
+
+        // the checked range [offset, offset + byte_count) of the contents
+        std::span<const byte> readView(size_t offset, size_t byte_count) const;
         std::vector<byte> read(size_t offset, size_t byte_count) const;
         void write(size_t offset, const std::vector<byte>& bytes_to_write);
+        void write(size_t offset, std::span<const byte> bytes_to_write);
 
     public:
         BinaryFile(const fs::path& path);
         BinaryFile(std::vector<byte>&& bytes);
 
+        // the contents and any buffer built to replace them are allocated from resource, which must
+        // outlive the file, see memory_resource.h for an arena and huge pages
+        BinaryFile(const fs::path& path, std::pmr::memory_resource* resource);
+        BinaryFile(std::pmr::vector<byte>&& bytes);
+
         byte read1(size_t offset) const;
         _2bytes read2(size_t offset) const;
         _4bytes read3(size_t offset) const;
@@ -46,6 +108,23 @@ namespace binary_file {
         void output() const;
 
         const std::optional<fs::path>& getInputPath() const;
+
+        size_t getSize() const;
+        std::span<const byte> getView() const;
+
+        // nullptr while the contents come from the global allocator or shared memory
+        std::pmr::memory_resource* getMemoryResource() const;
+
+        bool isShared() const;
+        void unshare();
+
+        // opt-in, records which owner every write came from until disabled, the first setWriteOwner
+        // enables it too, writes made by other means (expand, convertMapper) aren't recorded and
+        // convertMapper forgets everything recorded so far since the bytes move
+        void enableProvenance();
+        void disableProvenance();
+        void setWriteOwner(std::string_view owner);
+        const std::optional<WriteProvenance>& getProvenance() const;
     };
 }
 
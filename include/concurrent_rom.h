@@ -0,0 +1,127 @@
+#ifndef CONCURRENT_ROM_H
+#define CONCURRENT_ROM_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rom.h"
+#include "address.h"
+#include "exception.h"
+
+namespace binary_file {
+	class WriteConflictException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	// Wraps a rom so independent writers on different threads can patch it at the same time.
+	// The rom is split into 32 KiB pages, the first writer to touch (or claim) a page owns it
+	// and any other writer touching that page gets a WriteConflictException instead of racing.
+	// Every access locks only the pages it touches, so writers on disjoint pages never contend.
+	// The wrapped rom must outlive this and must not be resized or written to directly meanwhile.
+	// If the rom tracks write provenance, writes are recorded under their writer's name one at a
+	// time, since the record is shared by the whole rom, and the rom's own owner is put back after.
+	class ConcurrentRom {
+	public:
+		static constexpr size_t page_size{ 0x8000 };
+
+		// one thread at a time per writer, give each thread its own
+		class Writer {
+		public:
+			void claim(Address address, size_t byte_count);
+
+			void write1(Address address, byte byte_to_write);
+			void write2(Address address, _2bytes bytes_to_write);
+			void write3(Address address, _4bytes bytes_to_write);
+			void write4(Address address, _4bytes bytes_to_write);
+
+			std::string getName() const;
+
+		private:
+			friend class ConcurrentRom;
+
+			Writer(ConcurrentRom& rom, uint32_t owner);
+
+			ConcurrentRom& rom;
+			uint32_t owner;
+		};
+
+		ConcurrentRom(Rom& rom);
+		~ConcurrentRom();
+
+		ConcurrentRom(const ConcurrentRom&) = delete;
+		ConcurrentRom& operator=(const ConcurrentRom&) = delete;
+
+		Writer writer(std::string_view name);
+
+		byte read1(Address address) const;
+		_2bytes read2(Address address) const;
+		_4bytes read3(Address address) const;
+		_4bytes read4(Address address) const;
+
+		std::optional<std::string> getOwner(Address address) const;
+
+	private:
+		class PageLock {
+		public:
+			void lock();
+			void unlock();
+
+		private:
+			std::atomic_flag locked{};
+		};
+
+		struct Page {
+			std::atomic<uint32_t> owner{ 0 };
+			PageLock lock{};
+		};
+
+		// holds the locks of a sorted list of pages for its lifetime, so a throwing access can't
+		// leave a page locked
+		class PagesGuard {
+		public:
+			PagesGuard(const ConcurrentRom& rom, const std::vector<size_t>& page_indices);
+			~PagesGuard();
+
+			PagesGuard(const PagesGuard&) = delete;
+			PagesGuard& operator=(const PagesGuard&) = delete;
+
+		private:
+			const ConcurrentRom& rom;
+			const std::vector<size_t>& page_indices;
+		};
+
+		Rom& rom;
+		const size_t page_count;
+		std::unique_ptr<Page[]> pages;
+
+		mutable std::mutex names_mutex{};
+		std::vector<std::string> names{};
+
+		// provenance recording isn't thread safe, 0 for the rom's own owner
+		const bool records_provenance;
+		std::string original_owner{};
+		std::mutex provenance_mutex{};
+		uint32_t provenance_owner{ 0 };
+
+		std::vector<size_t> offsetsOf(Address address, size_t byte_count) const;
+		std::vector<size_t> pagesOf(const std::vector<size_t>& offsets) const;
+
+		// claims every page or, if one is owned by another writer, none of them
+		void claimPages(const std::vector<size_t>& page_indices, uint32_t owner, Address address);
+		void lockPages(const std::vector<size_t>& page_indices) const;
+		void unlockPages(const std::vector<size_t>& page_indices) const;
+
+		_4bytes read(Address address, size_t byte_count) const;
+		void write(uint32_t owner, Address address, _4bytes bytes_to_write, size_t byte_count);
+		void writeBytes(const std::vector<size_t>& offsets, _4bytes bytes_to_write);
+
+		std::string nameOf(uint32_t owner) const;
+	};
+}
+
+#endif // CONCURRENT_ROM_H
@@ -0,0 +1,30 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <vector>
+
+#include "binary_file.h"
+#include "rom.h"
+#include "address.h"
+
+namespace binary_file {
+	struct DiffRange {
+		size_t offset;
+		size_t length;
+	};
+
+	struct RomDiffRange {
+		Address address;
+		size_t length;
+	};
+
+	// ranges of differing bytes in ascending order, ranges separated by at most merge_gap equal bytes
+	// are reported as one, bytes past the end of the shorter file always count as differing
+	std::vector<DiffRange> diff(const BinaryFile& lhs, const BinaryFile& rhs, size_t merge_gap = 0);
+
+	// same as above, but each range starts at an address under the roms' mapper, which is derived for
+	// either rom that doesn't have one yet, roms with different mappers or SA-1 banks can't be compared
+	std::vector<RomDiffRange> diff(Rom& lhs, Rom& rhs, size_t merge_gap = 0);
+}
+
+#endif // DIFF_H
@@ -0,0 +1,18 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <span>
+
+#include "binary_file.h"
+
+namespace binary_file {
+	// XXH64, fast enough to fingerprint whole roms and stable across platforms and versions, so its
+	// values can be stored on disk
+	uint64_t hash64(std::span<const byte> bytes, uint64_t seed = 0);
+
+	// the zlib/IPS/No-Intro CRC-32, pass the previous result as crc to continue over several spans
+	uint32_t crc32(std::span<const byte> bytes, uint32_t crc = 0);
+}
+
+#endif // HASH_H
@@ -1,6 +1,8 @@
 #ifndef LIBSTR_H
 #define LIBSTR_H
 
+#include <cstdint>
+
 namespace binary_file {
 	extern const unsigned char char_props[256];
 
@@ -13,6 +15,27 @@ namespace binary_file {
 	inline bool is_ualpha(unsigned char c) { return char_props[c] & 0x28; }
 	inline bool is_ualnum(unsigned char c) { return char_props[c] & 0x68; }
 	inline bool is_xdigit(unsigned char c) { return char_props[c] & 0x01; }
+
+	// the classes with vectorized scans, values are their char_props bits so results match the is_* above
+	enum class char_class : unsigned char {
+		space = 0x80,
+		digit = 0x40,
+		ualnum = 0x68,
+		xdigit = 0x01
+	};
+
+	inline bool is_class(unsigned char c, char_class cls) { return char_props[c] & static_cast<unsigned char>(cls); }
+
+	// bit i is set if block[i] is in the class, block must have 16/32 readable bytes
+	uint16_t class_mask16(const char* block, char_class cls);
+	uint32_t class_mask32(const char* block, char_class cls);
+
+	// first character in [begin, end) that is (find) or isn't (skip) in the class, end if there is none
+	const char* find_class(const char* begin, const char* end, char_class cls);
+	const char* skip_class(const char* begin, const char* end, char_class cls);
+
+	inline const char* skip_space(const char* begin, const char* end) { return skip_class(begin, end, char_class::space); }
+	inline const char* find_space(const char* begin, const char* end) { return find_class(begin, end, char_class::space); }
 }
 
 #endif // LIBSTR_H
@@ -1,6 +1,10 @@
 #ifndef MAPPER_H
 #define MAPPER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
 namespace binary_file {
 	enum class Mapper {
 		LO_ROM,
@@ -12,6 +16,71 @@ namespace binary_file {
 		EX_HI_ROM,
 		NO_ROM
 	};
+
+	// asar's name for the mapper
+	constexpr std::string_view mapperName(Mapper mapper) {
+		switch (mapper) {
+		case Mapper::LO_ROM:
+			return "lorom";
+
+		case Mapper::HI_ROM:
+			return "hirom";
+
+		case Mapper::SA1_ROM:
+			return "sa1rom";
+
+		case Mapper::BIG_SA1_ROM:
+			return "fullsa1rom";
+
+		case Mapper::SFX_ROM:
+			return "sfxrom";
+
+		case Mapper::EX_LO_ROM:
+			return "exlorom";
+
+		case Mapper::EX_HI_ROM:
+			return "exhirom";
+
+		case Mapper::NO_ROM:
+		default:
+			return "norom";
+		}
+	}
+
+	// SA-1 Super MMC bank registers, each selects which 1 MiB block of the rom a bank range shows:
+	// CXB $00-$1F/$C0-$CF, DXB $20-$3F/$D0-$DF, EXB $80-$9F/$E0-$EF, FXB $A0-$BF/$F0-$FF
+	// only the block number bits of each register are kept, the default is the power-on 0, 1, 2, 3
+	class Sa1Banks {
+	public:
+		static constexpr size_t slot_count{ 4 };
+		static constexpr size_t config_count{ 1 << (3 * slot_count) };
+
+		constexpr Sa1Banks() = default;
+
+		static constexpr Sa1Banks fromRegisters(uint8_t cxb, uint8_t dxb, uint8_t exb, uint8_t fxb) {
+			return fromPacked(static_cast<uint16_t>((cxb & 7) | (dxb & 7) << 3 | (exb & 7) << 6 | (fxb & 7) << 9));
+		}
+
+		static constexpr Sa1Banks fromPacked(uint16_t packed) {
+			Sa1Banks banks{};
+			banks.packed = packed & (config_count - 1);
+			return banks;
+		}
+
+		// slot 0 is CXB, 1 is DXB, 2 is EXB and 3 is FXB
+		constexpr uint8_t block(size_t slot) const {
+			return (packed >> (3 * slot)) & 7;
+		}
+
+		constexpr uint16_t getPacked() const {
+			return packed;
+		}
+
+		constexpr bool operator==(const Sa1Banks& rhs) const = default;
+
+	private:
+		uint16_t packed{ 0 | 1 << 3 | 2 << 6 | 3 << 9 };
+	};
 }
 
 #endif // MAPPER_H
@@ -0,0 +1,51 @@
+#ifndef MEMORY_RESOURCE_H
+#define MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace binary_file {
+	constexpr size_t huge_page_size{ 2 << 20 };
+
+	// Anonymous memory in 2 MiB huge pages where the system has them reserved, otherwise in 2 MiB
+	// aligned normal pages marked for transparent huge pages, populated up front either way. Every
+	// allocation takes whole huge pages, so this is an upstream for ArenaResource, not something to
+	// allocate single files from. Thread-safe, lives as long as the program.
+	std::pmr::memory_resource* hugePageResource();
+
+	// Hands out one block taken from upstream front to back and frees nothing until release, which
+	// drops everything at once but keeps the block, so the next batch finds its pages already
+	// faulted in. Running past the block continues in new chunks from upstream that release does
+	// give back. Not thread-safe, give each worker its own arena, and every file allocated from it
+	// must be gone before release or destruction.
+	class ArenaResource : public std::pmr::memory_resource {
+	public:
+		static constexpr size_t default_capacity{ 64 << 20 };
+
+		explicit ArenaResource(size_t capacity = default_capacity, std::pmr::memory_resource* upstream = hugePageResource());
+		~ArenaResource() override;
+
+		ArenaResource(const ArenaResource&) = delete;
+		ArenaResource& operator=(const ArenaResource&) = delete;
+
+		void release();
+
+		// bytes handed out since construction or the last release
+		size_t getUsed() const;
+		size_t getCapacity() const;
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	private:
+		std::pmr::memory_resource* upstream;
+		size_t capacity;
+		void* block;
+		std::pmr::monotonic_buffer_resource arena;
+		size_t used{ 0 };
+	};
+}
+
+#endif // MEMORY_RESOURCE_H
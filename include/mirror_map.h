@@ -0,0 +1,66 @@
+#ifndef MIRROR_MAP_H
+#define MIRROR_MAP_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "address.h"
+#include "mapper.h"
+
+namespace binary_file {
+	struct SnesRange {
+		size_t snes_address;
+		size_t length;
+	};
+
+	// Every 32 KiB block of the SNES address space resolved once for a mapper and SA-1 bank
+	// configuration, so finding the rom offset behind an SNES address, all SNES addresses showing a
+	// rom offset, or the canonical one of those (the address Address::PC gives) are table lookups.
+	// Only rom is covered, RAM and I/O mirrors are not.
+	class MirrorMap {
+	public:
+		static constexpr size_t block_size{ 0x8000 };
+		static constexpr size_t block_count{ 0x1000000 / block_size };
+
+		MirrorMap(Mapper mapper, Sa1Banks sa1_banks = Sa1Banks());
+
+		std::optional<size_t> toPc(size_t snes_address) const;
+
+		// nullopt for addresses that don't map to rom
+		std::optional<size_t> canonicalize(size_t snes_address) const;
+		Address canonicalize(Address address) const;
+
+		// addresses that don't map to rom are passed through unchanged, large lists are split
+		// across threads
+		std::vector<size_t> canonicalize(std::span<const size_t> snes_addresses) const;
+
+		// every SNES address of a rom offset in ascending order
+		std::vector<size_t> mirrorsOf(size_t pc_address) const;
+		// every SNES range showing part of [pc_address, pc_address + length) in ascending order, ranges
+		// that continue each other in both address spaces are merged
+		std::vector<SnesRange> mirrorsOf(size_t pc_address, size_t length) const;
+
+		Mapper getMapper() const;
+		Sa1Banks getSa1Banks() const;
+
+	private:
+		static constexpr uint32_t unmapped{ UINT32_MAX };
+
+		struct Block {
+			uint32_t pc_base;
+			uint32_t canonical_base;
+		};
+
+		Mapper mapper;
+		Sa1Banks sa1_banks;
+
+		std::array<Block, block_count> blocks{};
+		// SNES blocks by the PC block they show, ascending
+		std::vector<std::vector<uint16_t>> mirror_blocks{};
+	};
+}
+
+#endif // MIRROR_MAP_H
@@ -7,8 +7,15 @@
 #include "libstr.h"
 #include "address.h"
 #include "mapper.h"
+#include "rom_index.h"
+#include "usage_map.h"
 
 namespace binary_file {
+	class MapperConversionException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
 	class Rom : public BinaryFile {
 	public:
 		using BinaryFile::BinaryFile;
@@ -19,6 +26,39 @@ namespace binary_file {
 		Rom(std::vector<byte>&& bytes);
 		Rom(std::vector<byte>&& bytes, Mapper mapper);
 
+		Rom(const fs::path& path, std::pmr::memory_resource* resource);
+		Rom(const fs::path& path, Mapper mapper, std::pmr::memory_resource* resource);
+
+		Rom(std::pmr::vector<byte>&& bytes);
+		Rom(std::pmr::vector<byte>&& bytes, Mapper mapper);
+
+		// attaches read-only to the copy of path another process published to shared memory, or loads
+		// it, derives the mapper and publishes it for the next process, the first write copies the
+		// bytes into this process, on windows this is just a normal load
+		// a published copy stays in shared memory after every process using it has exited, publishing
+		// unlinks this user's copies whose file was deleted, renamed or changed since, dropShared
+		// unlinks one right away
+		static Rom openShared(const fs::path& path);
+		static void dropShared(const fs::path& path);
+
+		// loads path and takes the mapper, header, chunk hashes and free ranges from its .bfidx sidecar
+		// if that is still valid, otherwise derives them and writes a new sidecar when the directory
+		// allows it
+		static Rom openIndexed(const fs::path& path);
+
+		// the index describes the contents when it was built, call rebuildIndex after writing, expand,
+		// convertMapper and changing the mapper or SA-1 banks drop it so the next call rebuilds it
+		const RomIndex& getIndex();
+		void rebuildIndex();
+
+		RomHeader getHeader();
+
+		// classifies every 32 KiB block of the current contents, keyed by SNES bank under the mapper
+		UsageMap analyzeUsage(const UsageHeuristics& heuristics = UsageHeuristics());
+
+		// who last wrote each byte of the SNES range, in PC offsets, empty unless provenance is enabled
+		std::vector<WriteRecord> ownersOf(Address address, size_t byte_count) const;
+
 		void ensureMapper();
 
 		Address pc(size_t pc_address);
@@ -30,19 +70,50 @@ namespace binary_file {
 		void setMapper(Mapper mapper);
 		void deriveMapper();
 
+		Sa1Banks getSa1Banks() const;
+		void setSa1Banks(Sa1Banks sa1_banks);
+
+		// grows the rom in place to new_size bytes padded with fill and updates the header's size byte and
+		// checksum, new_size must fit in the address space of the current mapper
+		void expand(size_t new_size, byte fill = 0x00);
+
+		// moves every 32 KiB page to wherever its SNES address lives under the new mapper, copies bank $00
+		// along if the new mapper doesn't mirror it, expands as needed and updates the header's map mode,
+		// size byte and checksum, sets an SA-1 chip byte when converting to SA-1 and clears the old header
+		// copy if the header moved, so deriveMapper finds the new mapper again, pointers stored in the rom
+		// are left untouched
+		void convertMapper(Mapper new_mapper, byte fill = 0x00);
+
 		// note reads are always on SNES addresses, relevant for bank breaks and whatever
-		byte read1(Address&& address) const;
-		_2bytes read2(Address&& address) const;
-		_4bytes read3(Address&& address) const;
-		_4bytes read4(Address&& address) const;
+		byte read1(Address address) const;
+		_2bytes read2(Address address) const;
+		_4bytes read3(Address address) const;
+		_4bytes read4(Address address) const;
+
+		void write1(Address address, byte byte_to_write);
+		void write2(Address address, _2bytes bytes_to_write);
+		void write3(Address address, _4bytes bytes_to_write);
+		void write4(Address address, _4bytes bytes_to_write);
 
-		void write1(Address&& address, byte byte_to_write);
-		void write2(Address&& address, _2bytes bytes_to_write);
-		void write3(Address&& address, _4bytes bytes_to_write);
-		void write4(Address&& address, _4bytes bytes_to_write);
+		// bulk access to an SNES range, copied in runs that never cross a 32 KiB page, a write
+		// checks the whole range before changing anything
+		std::vector<byte> readRange(Address address, size_t byte_count) const;
+		void writeRange(Address address, std::span<const byte> bytes_to_write);
+
+		// PC offset and length of each page-bounded run making up an SNES range, throws if any of it
+		// isn't rom
+		std::vector<std::pair<size_t, size_t>> runsOf(Address address, size_t byte_count) const;
 
 	private:
 		std::optional<Mapper> mapper;
+		Sa1Banks sa1_banks{};
+		std::optional<RomIndex> index{};
+
+		Rom(const fs::path& path, std::shared_ptr<const void> shared_owner, std::span<const byte> shared_bytes,
+			std::optional<Mapper> mapper, Sa1Banks sa1_banks);
+
+		void updateHeader();
+
 	};
 }
 
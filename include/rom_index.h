@@ -0,0 +1,81 @@
+#ifndef ROM_INDEX_H
+#define ROM_INDEX_H
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "binary_file.h"
+#include "mapper.h"
+
+namespace fs = std::filesystem;
+
+namespace binary_file {
+	// the internal header at SNES $00:FFC0-$00:FFDF
+	struct RomHeader {
+		static constexpr size_t size{ 0x20 };
+
+		std::string title;
+		byte map_mode;
+		byte rom_type;
+		byte rom_size;
+		byte sram_size;
+		byte region;
+		byte developer;
+		byte version;
+		_2bytes checksum_complement;
+		_2bytes checksum;
+
+		static RomHeader fromBytes(std::span<const byte, size> bytes);
+	};
+
+	// a run of at least min_length copies of fill, PC offsets
+	struct FreeRange {
+		static constexpr size_t min_length{ 0x100 };
+
+		size_t offset;
+		size_t length;
+		byte fill;
+	};
+
+	// Everything Rom derives from a file that is worth keeping between runs. It is stored next to the
+	// rom as "<rom>.bfidx" and only trusted while the rom's size, mtime and fingerprint still match,
+	// bumping version invalidates every index written by older code.
+	struct RomIndex {
+		static constexpr uint32_t version{ 1 };
+		static constexpr size_t chunk_size{ 0x10000 };
+
+		std::optional<Mapper> mapper;
+		Sa1Banks sa1_banks;
+		std::array<byte, RomHeader::size> header_bytes;
+		size_t size;
+		uint64_t fingerprint;
+		std::vector<uint64_t> chunk_hashes;
+		std::vector<FreeRange> free_ranges;
+
+		// header_bytes are left zeroed if the rom is too small to have a header under mapper
+		static RomIndex build(std::span<const byte> bytes, std::optional<Mapper> mapper, Sa1Banks sa1_banks);
+
+		// hashes the size, the first and last 4 KiB and 64 bytes out of every 64 KiB, catches edits
+		// that keep the size and mtime (coarse mtime resolution, tools that restore it) at a fraction
+		// of the cost of hashing the whole rom
+		static uint64_t fingerprintOf(std::span<const byte> bytes);
+
+		static fs::path pathOf(const fs::path& rom_path);
+
+		// nullopt if there is no index for rom_path, it is corrupt, was written by another version or
+		// doesn't match the rom's size, mtime or fingerprint
+		static std::optional<RomIndex> load(const fs::path& rom_path, std::span<const byte> bytes);
+
+		// written to a temporary file and renamed over the old index so readers never see half of it,
+		// mtime is the rom's modification time from before it was read
+		void save(const fs::path& rom_path, fs::file_time_type mtime) const;
+
+		RomHeader getHeader() const;
+	};
+}
+
+#endif // ROM_INDEX_H
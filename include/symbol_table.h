@@ -0,0 +1,76 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "rom.h"
+#include "address.h"
+#include "exception.h"
+
+namespace fs = std::filesystem;
+
+namespace binary_file {
+	class SymbolFileException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	// Labels loaded from a symbol file, either WLA style as written by asar (only the [labels]
+	// section is read) or plain no$sns style lists, with one "bank:addr label" or "bbaaaaaa label"
+	// per line. Files are memory mapped and parsed in parallel line-aligned chunks straight into one
+	// pool of label names, which are looked up through an open addressing hash table. A label defined
+	// more than once keeps a single copy of its name in the pool.
+	class SymbolTable {
+	public:
+		SymbolTable(const fs::path& path);
+
+		std::optional<size_t> find(std::string_view label) const;
+		std::optional<Address> find(std::string_view label, Rom& rom) const;
+
+		// all labels at exactly this SNES address in file order
+		std::vector<std::string_view> labelsAt(size_t snes_address) const;
+		std::vector<std::string_view> labelsAt(const Address& address) const;
+
+		size_t getSize() const;
+
+	private:
+		struct Symbol {
+			uint32_t name_offset;
+			uint32_t name_length;
+			uint32_t snes_address;
+		};
+
+		struct Slot {
+			uint32_t hash;
+			uint32_t symbol; // index + 1, 0 for empty slots
+		};
+
+		// what one line-aligned chunk of the file parsed, names index its own pool until the chunks
+		// are joined
+		struct Chunk {
+			std::vector<char> names{};
+			std::vector<Symbol> symbols{};
+			std::vector<uint32_t> hashes{};
+		};
+
+		std::vector<char> names{};
+		std::vector<Symbol> symbols{};
+		std::vector<Slot> slots{};
+		std::vector<uint32_t> by_address{};
+
+		std::string_view nameOf(const Symbol& symbol) const;
+		const Symbol* lookup(std::string_view label, uint32_t hash) const;
+		// returns the symbol already holding the label, or symbol if it is new
+		uint32_t insert(uint32_t symbol, uint32_t hash);
+		// points each (duplicate, first definition) pair at one name and drops the other copies
+		void shareNames(const std::vector<std::pair<uint32_t, uint32_t>>& duplicates);
+
+		static void parseChunk(std::string_view text, size_t begin, size_t end, Chunk& chunk);
+	};
+}
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,120 @@
+#ifndef TEXT_TABLE_H
+#define TEXT_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rom.h"
+#include "address.h"
+#include "exception.h"
+
+namespace fs = std::filesystem;
+
+namespace binary_file {
+	class TableFileException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	class TextEncodingException : public BinaryFileException {
+	public:
+		using BinaryFileException::BinaryFileException;
+	};
+
+	// count pointers of pointer_size (2 or 3) bytes at address, 2-byte pointers point into bank, or
+	// the table's own bank if it isn't given, strings are at most max_length bytes including their
+	// end token if it is given
+	struct PointerTable {
+		Address address;
+		size_t count;
+		size_t pointer_size{ 3 };
+		std::optional<byte> bank{};
+		std::optional<size_t> max_length{};
+	};
+
+	// A .tbl file, one "hex=text" entry per line, "/hex" or "/hex=text" marks an end token and
+	// "*hex" a line break. Both directions match greedily through tries compiled from the entries,
+	// bytes without an entry decode to "[XX]" and "[XX]" encodes to a raw byte unless a longer
+	// entry matches there.
+	class TextTable {
+	public:
+		TextTable(const fs::path& path);
+
+		// stops after the first end token, consumed receives the number of bytes used
+		std::string decode(std::span<const byte> bytes, size_t* consumed = nullptr) const;
+		// the end token isn't added, an unencodable character throws a TextEncodingException
+		std::vector<byte> encode(std::string_view text) const;
+
+		std::optional<std::vector<byte>> getEndToken() const;
+
+		// strings are decoded in parallel, directly out of the rom, up to their end token or
+		// table.max_length bytes, one of which the table has to have
+		std::vector<std::string> extract(Rom& rom, const PointerTable& table) const;
+
+		// encodes strings in parallel, each followed by the end token, which the table has to have,
+		// lays them out from text_start with identical strings shared and points the table at them,
+		// nothing is written if they don't fit in text_capacity bytes, one is longer than
+		// table.max_length, 2-byte pointers would have to leave the bank or the text would overlap
+		// the pointer table
+		void insert(Rom& rom, const PointerTable& table, std::span<const std::string> strings,
+			Address text_start, size_t text_capacity) const;
+
+	private:
+		enum class EntryKind {
+			TEXT,
+			END,
+			LINE_BREAK
+		};
+
+		struct Entry {
+			std::vector<byte> code;
+			std::string text;
+			EntryKind kind;
+		};
+
+		// byte strings to entry indices, built in maps and then flattened into sorted edge lists
+		class Trie {
+		public:
+			void insert(std::span<const byte> key, uint32_t entry);
+			void compile();
+
+			// the entry with the longest key that prefixes input and that key's length
+			std::optional<std::pair<uint32_t, size_t>> longestMatch(std::span<const byte> input) const;
+
+		private:
+			static constexpr uint32_t no_entry{ UINT32_MAX };
+
+			struct Node {
+				uint32_t first_edge;
+				uint32_t edge_count;
+				uint32_t entry;
+			};
+
+			std::vector<std::map<byte, uint32_t>> building{ 1 };
+			std::vector<uint32_t> building_entries{ no_entry };
+
+			std::array<uint32_t, 256> root_edges{};
+			std::vector<Node> nodes{};
+			std::vector<byte> edge_bytes{};
+			std::vector<uint32_t> edge_targets{};
+
+			uint32_t child(uint32_t node, byte value) const;
+		};
+
+		std::vector<Entry> entries{};
+		Trie decoder{};
+		Trie encoder{};
+		std::optional<uint32_t> end_entry{};
+
+		void addLine(std::string_view line, size_t line_number, const fs::path& path);
+	};
+}
+
+#endif // TEXT_TABLE_H
@@ -0,0 +1,42 @@
+#ifndef TILE_CODEC_H
+#define TILE_CODEC_H
+
+#include <span>
+#include <vector>
+
+#include "rom.h"
+#include "address.h"
+
+namespace binary_file {
+	// BPP2/BPP4/BPP8 are the planar 8x8 formats, bitplanes stored in interleaved pairs per row,
+	// MODE_7 is one byte per pixel as mode 7 graphics are kept in the rom before being
+	// interleaved with the tilemap on upload
+	enum class TileFormat {
+		BPP2,
+		BPP4,
+		BPP8,
+		MODE_7
+	};
+
+	constexpr size_t pixels_per_tile{ 64 };
+
+	size_t tileSize(TileFormat format);
+
+	// pixels are one palette index per byte, 64 per tile in row order, bits above the format's depth
+	// are ignored when encoding, planar.size() must be a multiple of the tile size and pixels.size()
+	// must match its tile count
+	void decodeTiles(TileFormat format, std::span<const byte> planar, std::span<byte> pixels);
+	void encodeTiles(TileFormat format, std::span<const byte> pixels, std::span<byte> planar);
+
+	std::vector<byte> decodeTiles(const Rom& rom, Address address, size_t tile_count, TileFormat format);
+	void encodeTiles(Rom& rom, Address address, TileFormat format, std::span<const byte> pixels);
+
+	namespace detail {
+		// the plain bit by bit codec on one thread, compiled whatever SIMD is enabled so the vector
+		// path always has a reference to be checked against (bench/tile_codec_bench.cpp)
+		void decodeTilesScalar(TileFormat format, std::span<const byte> planar, std::span<byte> pixels);
+		void encodeTilesScalar(TileFormat format, std::span<const byte> pixels, std::span<byte> planar);
+	}
+}
+
+#endif // TILE_CODEC_H
@@ -0,0 +1,87 @@
+#ifndef USAGE_MAP_H
+#define USAGE_MAP_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "binary_file.h"
+#include "mapper.h"
+#include "rom_index.h"
+
+namespace binary_file {
+	enum class BlockUsage {
+		FREE,
+		POINTERS,
+		CODE,
+		GRAPHICS,
+		COMPRESSED,
+		DATA
+	};
+
+	// Thresholds for classifying a block, checked in the order of BlockUsage, the first one a block
+	// meets wins and DATA is what's left. The defaults are rough starting points, tune them per rom.
+	struct UsageHeuristics {
+		// runs of 0x00 or 0xFF shorter than this count as data, never less than 16
+		size_t min_free_run{ FreeRange::min_length };
+		// share of the block in free runs
+		double free_share{ 0.9 };
+		// share of 16-bit words, at the better alignment, that look like one of a run of pointers
+		// into $8000-$FFFF, their high bytes at most 2 apart
+		double pointer_share{ 0.5 };
+		// share of bytes that are common 65c816 opcodes, random data lands around 0.15
+		double opcode_share{ 0.22 };
+		// share of byte pairs two apart that are equal, not counting two zeroes, which is how
+		// neighbouring rows of a bitplane look, random data lands around 0.004
+		double row_repeat_share{ 0.2 };
+		// bits per byte, plain data rarely gets near 8
+		double compressed_entropy{ 7.4 };
+	};
+
+	struct BlockStats {
+		size_t pc_offset;
+		size_t length;
+		std::array<uint32_t, 256> histogram;
+		double entropy;
+		size_t zero_run_bytes;
+		size_t ff_run_bytes;
+		size_t longest_free_run;
+		// valid RATS tags starting in the block and bytes of it covered by any tag and its data
+		size_t rats_tags;
+		size_t rats_bytes;
+		// holds part of the internal header and vectors at $00:FFB0-$00:FFFF
+		bool contains_header;
+		double pointer_share;
+		double opcode_share;
+		double row_repeat_share;
+		BlockUsage usage;
+
+		size_t getFreeBytes() const;
+	};
+
+	// Statistics for every 32 KiB of the rom keyed by the SNES bank its canonical address is in, so a
+	// HiROM bank holds two blocks and a LoROM bank one. Blocks the mapper doesn't show (SA-1 blocks
+	// outside the current bank registers) are kept apart.
+	struct UsageMap {
+		static constexpr size_t block_size{ 0x8000 };
+
+		Mapper mapper;
+		Sa1Banks sa1_banks;
+		std::map<size_t, std::vector<BlockStats>> banks;
+		std::vector<BlockStats> unmapped_blocks;
+
+		// one line, histograms are left out unless asked for
+		std::string toJson(bool include_histograms = false) const;
+	};
+
+	std::string_view usageName(BlockUsage usage);
+
+	// one pass over bytes split across threads, vectorized where the compiler allows it
+	UsageMap analyzeUsage(std::span<const byte> bytes, Mapper mapper, Sa1Banks sa1_banks,
+		const UsageHeuristics& heuristics = UsageHeuristics());
+}
+
+#endif // USAGE_MAP_H
@@ -0,0 +1,76 @@
+#ifndef WRITE_PROVENANCE_H
+#define WRITE_PROVENANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "exception.h"
+
+namespace binary_file {
+	// a run of bytes whose last write came from owner, PC offsets
+	struct WriteRecord {
+		size_t offset;
+		size_t length;
+		std::string owner;
+	};
+
+	// a run of bytes first written by one owner and then overwritten by another
+	struct WriteConflict {
+		size_t offset;
+		size_t length;
+		std::string first_owner;
+		std::string second_owner;
+	};
+
+	// Tracks which owner last wrote every byte as an interval map of runs keyed by their first offset,
+	// with neighbouring runs of one owner merged, and collects conflicts as they happen under owner
+	// ids, so recording and queries cost a lookup plus the runs they touch and names are only
+	// resolved when asked for. Not thread safe, like the BinaryFile it belongs to.
+	class WriteProvenance {
+	public:
+		void setOwner(std::string_view owner);
+		const std::string& getOwner() const;
+
+		void record(size_t offset, size_t length);
+
+		// runs inside [offset, offset + length) in address order, bytes nobody wrote are left out
+		std::vector<WriteRecord> ownersOf(size_t offset, size_t length) const;
+
+		// contiguous conflicts between the same two owners are merged
+		std::vector<WriteConflict> getConflicts() const;
+
+		void clear();
+
+	private:
+		struct Run {
+			size_t end;
+			uint16_t owner;
+		};
+
+		struct OwnerConflict {
+			size_t offset;
+			size_t length;
+			uint16_t first_owner;
+			uint16_t second_owner;
+		};
+
+		// owner ids are indices into owners plus one, writes made before setOwner belong to the
+		// empty owner
+		std::vector<std::string> owners{ "" };
+		uint16_t current_owner{ 1 };
+
+		std::map<size_t, Run> runs{};
+		std::vector<OwnerConflict> conflicts{};
+
+		// the first run ending after offset, for const and mutable runs alike
+		template<typename Runs>
+		static auto firstRunAfter(Runs& runs, size_t offset) -> decltype(runs.begin());
+		void addConflict(size_t offset, size_t length, uint16_t first_owner);
+	};
+}
+
+#endif // WRITE_PROVENANCE_H
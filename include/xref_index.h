@@ -0,0 +1,73 @@
+#ifndef XREF_INDEX_H
+#define XREF_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "rom.h"
+#include "address.h"
+
+namespace binary_file {
+	enum class XrefKind {
+		JSR,
+		JMP,
+		JSL,
+		JML,
+		JUMP_TABLE, // JMP (abs,X) and JSR (abs,X), the target is the table
+		LONG_DATA // any instruction with a long or long,X operand
+	};
+
+	struct Xref {
+		Address source;
+		XrefKind kind;
+	};
+
+	// Every JSR/JMP/JSL/JML and long addressed operand in a rom that points back into the rom,
+	// keyed by the PC address of its target so all mirrors of a routine share one entry.
+	// Built by a linear sweep of every 32 KiB page in parallel, starting each page with 8-bit A and
+	// X/Y and following REP/SEP from there, so data decoded as code adds some noise but absolute
+	// operands are always resolved in the bank of the instruction. JSR/JMP into RAM or I/O and
+	// long operands outside the rom are left out.
+	// The wrapped rom must outlive this, call refresh after writing to it or changing its mapper.
+	class XrefIndex {
+	public:
+		static constexpr size_t page_size{ 0x8000 };
+
+		XrefIndex(Rom& rom);
+
+		const std::vector<Xref>& referencesTo(size_t pc_address) const;
+		const std::vector<Xref>& referencesTo(Address address) const;
+
+		// re-sweeps only the pages whose contents changed since they were last swept, or every page
+		// if the rom's mapper or SA-1 banks changed
+		void refresh();
+		// re-sweeps the pages overlapping [pc_offset, pc_offset + length) unconditionally, and every
+		// other page too if the rom's mapper or SA-1 banks changed
+		void refresh(size_t pc_offset, size_t length);
+
+		size_t getSize() const;
+
+	private:
+		struct PageXref {
+			uint32_t target;
+			Xref xref;
+		};
+
+		Rom& rom;
+		// what the pages were swept with, sources and targets resolve differently under another one
+		Mapper mapper;
+		Sa1Banks sa1_banks;
+		std::vector<uint64_t> page_hashes{};
+		std::vector<std::vector<PageXref>> page_xrefs{};
+		std::unordered_map<uint32_t, std::vector<Xref>> by_target{};
+		size_t size{ 0 };
+
+		// forgets every page hash if the rom's mapping changed since the last sweep, so they all count
+		// as changed, true if it did
+		bool adoptMapping();
+		void sweep(const std::vector<size_t>& pages);
+		std::vector<PageXref> sweepPage(size_t page) const;
+	};
+}
+
+#endif // XREF_INDEX_H
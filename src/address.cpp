@@ -1,71 +1,229 @@
 #include "../include/address.h"
 
+#include <array>
+
+#include "../include/libstr.h"
+
 namespace binary_file {
-	int sa1banks[8] = { 0 << 20, 1 << 20, -1, -1, 2 << 20, 3 << 20, -1, -1 };
+	namespace {
+		// for every SA-1 bank configuration, which slot (CXB, DXB, EXB, FXB) first shows each 1 MiB block, -1 if none
+		constexpr auto sa1_slot_of_block{ [] {
+			std::array<std::array<int8_t, 8>, Sa1Banks::config_count> table{};
+
+			for (size_t config{ 0 }; config != Sa1Banks::config_count; ++config) {
+				const auto banks{ Sa1Banks::fromPacked(static_cast<uint16_t>(config)) };
+
+				table[config].fill(-1);
+				for (size_t slot{ Sa1Banks::slot_count }; slot-- != 0;) {
+					table[config][banks.block(slot)] = static_cast<int8_t>(slot);
+				}
+			}
+
+			return table;
+		}() };
+
+		// slot to bits 21-23 of its LoROM-style banks, $00, $20, $80 and $A0
+		constexpr std::array<size_t, Sa1Banks::slot_count> sa1_slot_banks{ 0, 1, 4, 5 };
+
+		size_t parseHex(const char* begin, const char* end) {
+			size_t value{ 0 };
+
+			for (; begin != end; ++begin) {
+				const auto c{ static_cast<unsigned char>(*begin) };
+				value = (value << 4) | (is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+			}
+
+			return value;
+		}
+	}
+
+	Address::Address(size_t address, std::optional<Mapper> mapper, Sa1Banks sa1_banks, bool is_pc) :
+		packed(mappingOf(mapper, sa1_banks) << mapping_shift) {
+		if (address > address_mask) {
+			if (is_pc) {
+				throwInvalidPcAddress(address);
+			}
+			else {
+				throwInvalidSnesAddress(address);
+			}
+		}
 
-	Address::Address(size_t address, std::optional<Mapper> mapper, bool is_pc) :
-		mapper(mapper),
-		pc_address(is_pc ? std::make_optional(address) : std::nullopt),
-		snes_address(is_pc ? std::nullopt : std::make_optional(address)) {}
+		std::optional<size_t> pc_address{ is_pc ? std::make_optional(address) : std::nullopt };
+		std::optional<size_t> snes_address{ is_pc ? std::nullopt : std::make_optional(address) };
+
+		if (mapper.has_value()) {
+			if (is_pc) {
+				snes_address = pcToSnes(address, mapper.value(), sa1_banks);
+			}
+			else {
+				pc_address = snesToPc(address, mapper.value(), sa1_banks);
+			}
+		}
+
+		if (snes_address.has_value()) {
+			packed |= has_snes_bit | snes_address.value();
+		}
+
+		if (pc_address.has_value()) {
+			packed |= has_pc_bit | (static_cast<uint64_t>(pc_address.value()) << pc_shift);
+		}
+	}
+
+	uint64_t Address::mappingOf(std::optional<Mapper> mapper, Sa1Banks sa1_banks) {
+		if (!mapper.has_value()) {
+			return 0;
+		}
+
+		if (mapper.value() == Mapper::SA1_ROM) {
+			return sa1_mapping + sa1_banks.getPacked();
+		}
+
+		return static_cast<uint64_t>(mapper.value()) + 1;
+	}
 
 	Address Address::PC(size_t pc_address) {
-		return Address(pc_address, std::nullopt, true);
+		return Address(pc_address, std::nullopt, Sa1Banks(), true);
 	}	
 	
 	Address Address::PC(size_t pc_address, Mapper mapper) {
-		return Address(pc_address, mapper, true);
+		return Address(pc_address, mapper, Sa1Banks(), true);
 	}
 
 	Address Address::SNES(size_t snes_address, Mapper mapper) {
-		return Address(snes_address, mapper, false);
+		return Address(snes_address, mapper, Sa1Banks(), false);
+	}
+
+	Address Address::PC(size_t pc_address, Mapper mapper, Sa1Banks sa1_banks) {
+		return Address(pc_address, mapper, sa1_banks, true);
+	}
+
+	Address Address::SNES(size_t snes_address, Mapper mapper, Sa1Banks sa1_banks) {
+		return Address(snes_address, mapper, sa1_banks, false);
+	}
+
+	std::optional<Address> Address::parse(std::string_view text, Mapper mapper, Sa1Banks sa1_banks) {
+		auto begin{ skip_space(text.data(), text.data() + text.size()) };
+		auto end{ text.data() + text.size() };
+
+		while (end != begin && is_space(end[-1])) {
+			--end;
+		}
+
+		const auto is_pc{ end - begin > 2 && begin[0] == '0' && (begin[1] | 0x20) == 'x' };
+
+		if (is_pc) {
+			begin += 2;
+		}
+		else if (begin != end && *begin == '$') {
+			++begin;
+		}
+
+		auto digits_end{ skip_class(begin, end, char_class::xdigit) };
+
+		if (digits_end == begin || digits_end - begin > 6) {
+			return std::nullopt;
+		}
+
+		auto value{ parseHex(begin, digits_end) };
+
+		if (!is_pc && digits_end != end && *digits_end == ':') {
+			const auto offset_begin{ digits_end + 1 };
+			const auto offset_end{ skip_class(offset_begin, end, char_class::xdigit) };
+
+			if (digits_end - begin > 2 || offset_end == offset_begin || offset_end - offset_begin > 4) {
+				return std::nullopt;
+			}
+
+			value = (value << 16) | parseHex(offset_begin, offset_end);
+			digits_end = offset_end;
+		}
+
+		if (digits_end != end) {
+			return std::nullopt;
+		}
+
+		return Address(value, mapper, sa1_banks, is_pc);
+	}
+
+	size_t Address::pc() const {
+		if (!hasPc()) {
+			throwInvalidSnesAddress(snes());
+		}
+
+		return (packed >> pc_shift) & address_mask;
+	}
+
+	size_t Address::snes() const {
+		if (hasSnes()) {
+			return packed & address_mask;
+		}
+
+		if (!getMapper().has_value()) {
+			throw MissingMapperException(fmt::format(
+				"No mapper specified trying to convert 0x{:06X} (PC) to SNES",
+				pc()
+			));
+		}
+
+		throwInvalidPcAddress(pc());
+
+		return 0; // unreachable, just making the compiler be quiet
 	}
 
-	size_t Address::pc() {
-		ensurePcAddress();
+	bool Address::hasPc() const {
+		return packed & has_pc_bit;
+	}
 
-		return pc_address.value();
+	bool Address::hasSnes() const {
+		return packed & has_snes_bit;
 	}
 
-	size_t Address::snes() {
-		ensureSnesAddress();
+	std::optional<Mapper> Address::getMapper() const {
+		const auto mapping{ (packed >> mapping_shift) & mapping_mask };
+
+		if (mapping == 0) {
+			return std::nullopt;
+		}
+
+		if (mapping >= sa1_mapping) {
+			return Mapper::SA1_ROM;
+		}
 
-		return snes_address.value();
+		return static_cast<Mapper>(mapping - 1);
+	}
+
+	Sa1Banks Address::getSa1Banks() const {
+		const auto mapping{ (packed >> mapping_shift) & mapping_mask };
+
+		if (mapping < sa1_mapping) {
+			return Sa1Banks();
+		}
+
+		return Sa1Banks::fromPacked(static_cast<uint16_t>(mapping - sa1_mapping));
 	}
 
 	Address& Address::operator+=(const size_t rhs) {
-		ensureSnesAddress();
-		snes_address = snes_address.value() + rhs;
-		updatePcFromSnes();
+		*this = *this + rhs;
 
 		return *this;
 	}
 
 	Address& Address::operator-=(const size_t rhs) {
-		ensureSnesAddress();
-		snes_address = snes_address.value() - rhs;
-		updatePcFromSnes();
+		*this = *this - rhs;
 
 		return *this;
 	}
 
-	Address Address::operator+(const size_t rhs) {
-		ensureSnesAddress();
-
-		return Address(snes_address.value() + rhs, mapper, false);
+	Address Address::operator+(const size_t rhs) const {
+		return Address(snes() + rhs, getMapper(), getSa1Banks(), false);
 	}
 
-	Address Address::operator-(const size_t rhs) {
-		ensureSnesAddress();
-
-		return Address(snes_address.value() - rhs, mapper, false);
+	Address Address::operator-(const size_t rhs) const {
+		return Address(snes() - rhs, getMapper(), getSa1Banks(), false);
 	}
 
 	Address& Address::operator++() {
-		ensureSnesAddress();
-		snes_address = snes_address.value() + 1;
-		updatePcFromSnes();
-
-		return *this;
+		return *this += 1;
 	}
 
 	Address Address::operator++(int) {
@@ -75,11 +233,7 @@ namespace binary_file {
 	}
 
 	Address& Address::operator--() {
-		ensureSnesAddress();
-		snes_address = snes_address.value() - 1;
-		updatePcFromSnes();
-
-		return *this;
+		return *this -= 1;
 	}
 
 	Address Address::operator--(int) {
@@ -88,37 +242,23 @@ namespace binary_file {
 		return old;
 	}
 
-	std::string Address::string() {
-		try {
-			ensurePcAddress();
-		}
-		catch (...) {
-			// pass
-		}
-
-		try {
-			ensureSnesAddress();
-		}
-		catch (...) {
-			// pass
-		}
-
-		if (snes_address.has_value() && pc_address.has_value()) {
+	std::string Address::string() const {
+		if (hasSnes() && hasPc()) {
 			return fmt::format(
 				"Address[SNES: ${:06X}, PC: 0x{:06X}]",
-				snes_address.value(), pc_address.value()
+				snes(), pc()
 			);
 		}
-		else if (snes_address.has_value()) {
+		else if (hasSnes()) {
 			return fmt::format(
 				"Address[SNES: ${:06X}]",
-				snes_address.value()
+				snes()
 			);
 		}
-		else if (pc_address.has_value()) {
+		else if (hasPc()) {
 			return fmt::format(
 				"Address[PC: 0x{:06X}]",
-				pc_address.value()
+				pc()
 			);
 		}
 		else {
@@ -126,15 +266,8 @@ namespace binary_file {
 		}
 	}
 
-	size_t Address::pcToSnes(size_t pc_address) {
-		if (!mapper.has_value()) {
-			throw MissingMapperException(fmt::format(
-				"No mapper specified trying to convert 0x{:06X} (PC) to SNES",
-				pc_address
-			));
-		}
-
-		switch (mapper.value()) {
+	std::optional<size_t> Address::pcToSnes(size_t pc_address, Mapper mapper, Sa1Banks sa1_banks) {
+		switch (mapper) {
 		case Mapper::LO_ROM:
 			return pcToLoRom(pc_address);
 
@@ -148,7 +281,7 @@ namespace binary_file {
 			return pcToExHiRom(pc_address);
 		
 		case Mapper::SA1_ROM:
-			return pcToSa1Rom(pc_address);
+			return pcToSa1Rom(pc_address, sa1_banks);
 
 		case Mapper::BIG_SA1_ROM:
 			return pcToBigSa1Rom(pc_address);
@@ -162,19 +295,12 @@ namespace binary_file {
 		}
 	}
 
-	size_t Address::snesToPc(size_t snes_address) {
-		if (!mapper.has_value()) {
-			throw MissingMapperException(fmt::format(
-				"No mapper specified trying to convert ${:06X} (SNES) to PC",
-				snes_address
-			));
-		}
-
+	std::optional<size_t> Address::snesToPc(size_t snes_address, Mapper mapper, Sa1Banks sa1_banks) {
 		if (snes_address > 0xFFFFFF) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
-		switch (mapper.value()) {
+		switch (mapper) {
 		case Mapper::LO_ROM:
 			return loRomToPc(snes_address);
 
@@ -188,7 +314,7 @@ namespace binary_file {
 			return exHiRomToPc(snes_address);
 
 		case Mapper::SA1_ROM:
-			return sa1RomToPc(snes_address);
+			return sa1RomToPc(snes_address, sa1_banks);
 
 		case Mapper::BIG_SA1_ROM:
 			return bigSa1RomToPc(snes_address);
@@ -202,24 +328,24 @@ namespace binary_file {
 		}
 	}
 
-	size_t Address::pcToLoRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToLoRom(size_t pc_address) {
 		if (pc_address >= 0x400000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 		pc_address = ((pc_address << 1) & 0x7F0000) | (pc_address & 0x7FFF) | 0x8000;
 		return pc_address | 0x800000;
 	}
 
-	size_t Address::pcToHiRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToHiRom(size_t pc_address) {
 		if (pc_address >= 0x400000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 		return pc_address | 0xC00000;
 	}
 
-	size_t Address::pcToExLoRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToExLoRom(size_t pc_address) {
 		if (pc_address >= 0x800000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 
 		if (pc_address & 0x400000) {
@@ -233,9 +359,9 @@ namespace binary_file {
 		}
 	}
 
-	size_t Address::pcToExHiRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToExHiRom(size_t pc_address) {
 		if (pc_address >= 0x800000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 
 		if (pc_address & 0x400000) {
@@ -245,21 +371,23 @@ namespace binary_file {
 		return pc_address | 0xC00000;
 	}
 
-	size_t Address::pcToSa1Rom(size_t pc_address) {
-		for (size_t i{ 0 }; i != 8; ++i) {
-			if (sa1banks[i] == (pc_address & 0x700000)) {
-				return 0x008000 | (i << 21) | ((pc_address & 0x0F8000) << 1) | (pc_address & 0x7FFF);
-			}
+	std::optional<size_t> Address::pcToSa1Rom(size_t pc_address, Sa1Banks sa1_banks) {
+		if (pc_address >= 0x800000) {
+			return std::nullopt;
 		}
 
-		throwInvalidPcAddress(pc_address);
+		const auto slot{ sa1_slot_of_block[sa1_banks.getPacked()][pc_address >> 20] };
 
-		return pc_address; // unreachable, just making the compiler be quiet
+		if (slot < 0) {
+			return std::nullopt;
+		}
+
+		return 0x008000 | (sa1_slot_banks[slot] << 21) | ((pc_address & 0x0F8000) << 1) | (pc_address & 0x7FFF);
 	}
 
-	size_t Address::pcToBigSa1Rom(size_t pc_address) {
+	std::optional<size_t> Address::pcToBigSa1Rom(size_t pc_address) {
 		if (pc_address >= 0x800000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 
 		if ((pc_address & 0x400000) == 0x400000) {
@@ -274,46 +402,44 @@ namespace binary_file {
 			return 0x800000 | ((pc_address << 1) & 0x3F0000) | 0x8000 | (pc_address & 0x7FFF);
 		}
 
-		throwInvalidPcAddress(pc_address);
-
-		return pc_address; // unreachable, just making the compiler be quiet
+		return std::nullopt;
 	}
 
-	size_t Address::pcToSfxRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToSfxRom(size_t pc_address) {
 		if (pc_address >= 0x200000) {
-			throwInvalidPcAddress(pc_address);
+			return std::nullopt;
 		}
 
 		return ((pc_address << 1) & 0x7F0000) | (pc_address & 0x7FFF) | 0x8000;
 	}
 
-	size_t Address::pcToNoRom(size_t pc_address) {
+	std::optional<size_t> Address::pcToNoRom(size_t pc_address) {
 		return pc_address;
 	}
 
-	size_t Address::loRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::loRomToPc(size_t snes_address) {
 		if ((snes_address & 0xFE0000) == 0x7E0000 ||
 			(snes_address & 0x408000) == 0x000000 ||
 			(snes_address & 0x708000) == 0x700000) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
 		return ((snes_address & 0x7F0000) >> 1 | (snes_address & 0x7FFF));
 	}
 
-	size_t Address::hiRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::hiRomToPc(size_t snes_address) {
 		if ((snes_address & 0xFE0000) == 0x7E0000 ||
 			(snes_address & 0x408000) == 0x000000) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
 		return snes_address & 0x3FFFFF;
 	}
 
-	size_t Address::exLoRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::exLoRomToPc(size_t snes_address) {
 		if ((snes_address & 0xF00000) == 0x700000 ||
 			(snes_address & 0x408000) == 0x000000) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
 		if (snes_address & 0x800000) {
@@ -326,10 +452,10 @@ namespace binary_file {
 		return snes_address;
 	}
 
-	size_t Address::exHiRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::exHiRomToPc(size_t snes_address) {
 		if ((snes_address & 0xFE0000) == 0x7E0000 ||
 			(snes_address & 0x408000) == 0x000000) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
 		if ((snes_address & 0x800000) == 0x000000) {
@@ -339,44 +465,42 @@ namespace binary_file {
 		return snes_address & 0x3FFFFF;
 	}
 
-	size_t Address::sa1RomToPc(size_t snes_address) {
+	std::optional<size_t> Address::sa1RomToPc(size_t snes_address, Sa1Banks sa1_banks) {
 		if ((snes_address & 0x408000) == 0x008000) {
-			return sa1banks[(snes_address & 0xE00000) >> 21] | ((snes_address & 0x1F0000) >> 1) | (snes_address & 0x007FFF);
+			const auto slot{ ((snes_address & 0x200000) >> 21) | ((snes_address & 0x800000) >> 22) };
+			return (static_cast<size_t>(sa1_banks.block(slot)) << 20) | ((snes_address & 0x1F0000) >> 1) | (snes_address & 0x007FFF);
 		}
 
 		if ((snes_address & 0xC00000) == 0xC00000) {
-			return sa1banks[((snes_address & 0x100000) >> 20) | ((snes_address & 0x200000) >> 19)] | (snes_address & 0x0FFFFF);
+			const auto slot{ (snes_address & 0x300000) >> 20 };
+			return (static_cast<size_t>(sa1_banks.block(slot)) << 20) | (snes_address & 0x0FFFFF);
 		}
 
-		throwInvalidSnesAddress(snes_address);
-
-		return snes_address; // unreachable, just making the compiler be quiet
+		return std::nullopt;
 	}
 
-	size_t Address::bigSa1RomToPc(size_t snes_address) {
+	std::optional<size_t> Address::bigSa1RomToPc(size_t snes_address) {
 		if ((snes_address & 0xC00000) == 0xC00000) {
 			return (snes_address & 0x3FFFFF) | 0x400000;
 		}
 
 		if ((snes_address & 0xC00000) == 0x000000 || (snes_address & 0xC00000) == 0x800000) {
 			if ((snes_address & 0x008000) == 0x000000) {
-				throwInvalidSnesAddress(snes_address);
+				return std::nullopt;
 			}
 			else {
 				return (snes_address & 0x800000) >> 2 | (snes_address & 0x3F0000) >> 1 | (snes_address & 0x7FFF);
 			}
 		}
 
-		throwInvalidSnesAddress(snes_address);
-
-		return snes_address; // unreachable, just making the compiler be quiet
+		return std::nullopt;
 	}
 
-	size_t Address::sfxRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::sfxRomToPc(size_t snes_address) {
 		if ((snes_address & 0x600000) == 0x600000 ||
 			(snes_address & 0x408000) == 0x000000 ||
 			(snes_address & 0x800000) == 0x800000) {
-			throwInvalidSnesAddress(snes_address);
+			return std::nullopt;
 		}
 
 		if (snes_address & 0x400000) {
@@ -386,28 +510,10 @@ namespace binary_file {
 		return (snes_address & 0x7F0000) >> 1 | (snes_address & 0x7FFF);
 	}
 
-	size_t Address::noRomToPc(size_t snes_address) {
+	std::optional<size_t> Address::noRomToPc(size_t snes_address) {
 		return snes_address;
 	}
 	
-	void Address::ensureSnesAddress() {
-		if (!snes_address.has_value()) {
-			snes_address = pcToSnes(pc_address.value());
-		}
-	}
-	
-	void Address::ensurePcAddress() {
-		if (!pc_address.has_value()) {
-			pc_address = snesToPc(snes_address.value());
-		}
-	}
-	
-	void Address::updatePcFromSnes() {
-		if (pc_address.has_value()) {
-			pc_address = snesToPc(snes_address.value());
-		}
-	}
-
 	void Address::throwInvalidPcAddress(size_t pc_address) {
 		throw InvalidAddressException(fmt::format(
 			"PC address 0x{:06X} is not valid and cannot be converted to a SNES address",
@@ -422,7 +528,7 @@ namespace binary_file {
 		));
 	}
 
-	std::ostream& operator<<(std::ostream& target, Address& source) {
+	std::ostream& operator<<(std::ostream& target, const Address& source) {
 		target << source.string();
 		return target;
 	}
@@ -1,7 +1,69 @@
 #include "../include/binary_file.h"
 
+#include <algorithm>
+
 namespace binary_file {
-    _4bytes BinaryFile::join(const std::vector<byte>& bytes) {
+    ByteStorage::ByteStorage(std::vector<byte>&& bytes) : storage(std::move(bytes)) {}
+
+    ByteStorage::ByteStorage(std::pmr::vector<byte>&& bytes) : storage(std::move(bytes)) {}
+
+    ByteStorage::ByteStorage(std::pmr::memory_resource* resource) {
+        if (resource != nullptr) {
+            storage.emplace<std::pmr::vector<byte>>(resource);
+        }
+    }
+
+    byte* ByteStorage::data() {
+        return std::visit([](auto& bytes) { return bytes.data(); }, storage);
+    }
+
+    const byte* ByteStorage::data() const {
+        return std::visit([](const auto& bytes) { return bytes.data(); }, storage);
+    }
+
+    size_t ByteStorage::size() const {
+        return std::visit([](const auto& bytes) { return bytes.size(); }, storage);
+    }
+
+    byte* ByteStorage::begin() {
+        return data();
+    }
+
+    byte* ByteStorage::end() {
+        return data() + size();
+    }
+
+    const byte* ByteStorage::begin() const {
+        return data();
+    }
+
+    const byte* ByteStorage::end() const {
+        return data() + size();
+    }
+
+    byte& ByteStorage::operator[](size_t index) {
+        return data()[index];
+    }
+
+    const byte& ByteStorage::operator[](size_t index) const {
+        return data()[index];
+    }
+
+    void ByteStorage::resize(size_t new_size, byte fill) {
+        std::visit([&](auto& bytes) { bytes.resize(new_size, fill); }, storage);
+    }
+
+    void ByteStorage::assign(std::span<const byte> new_bytes) {
+        std::visit([&](auto& bytes) { bytes.assign(new_bytes.begin(), new_bytes.end()); }, storage);
+    }
+
+    std::pmr::memory_resource* ByteStorage::getResource() const {
+        const auto pmr_bytes{ std::get_if<std::pmr::vector<byte>>(&storage) };
+
+        return pmr_bytes != nullptr ? pmr_bytes->get_allocator().resource() : nullptr;
+    }
+
+    _4bytes BinaryFile::join(std::span<const byte> bytes) {
         _4bytes joined{ 0 };
 
         size_t i{ 0 };
@@ -12,7 +74,13 @@ namespace binary_file {
         return joined;
     }
 
-    BinaryFile::BinaryFile(const fs::path& path) {
+    _4bytes BinaryFile::join(std::initializer_list<byte> bytes) {
+        return join(std::span<const byte>(bytes.begin(), bytes.size()));
+    }
+
+    BinaryFile::BinaryFile(const fs::path& path) : BinaryFile(path, nullptr) {}
+
+    BinaryFile::BinaryFile(const fs::path& path, std::pmr::memory_resource* resource) : bytes(resource), input_path(path) {
         if (!fs::exists(path)) {
             throw BinaryFileException(fmt::format(
                 "Binary file {} does not exist",
@@ -36,92 +104,140 @@ namespace binary_file {
             ));
         }
 
-        bytes.reserve(fs::file_size(path));
+        bytes.resize(fs::file_size(path));
 
-        bytes.insert(bytes.begin(),
-            std::istream_iterator<byte>(file),
-            std::istream_iterator<byte>());
+        if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+            throw BinaryFileException(fmt::format(
+                "Failed to read binary file {}",
+                path.string()
+            ));
+        }
     }
 
     BinaryFile::BinaryFile(std::vector<byte>&& bytes) : bytes(std::move(bytes)) {}
 
-    std::vector<byte> BinaryFile::read(size_t offset, size_t byte_count) const {
+    BinaryFile::BinaryFile(std::pmr::vector<byte>&& bytes) : bytes(std::move(bytes)) {}
+
+    BinaryFile::BinaryFile(const fs::path& path, std::shared_ptr<const void> shared_owner, std::span<const byte> shared_bytes) :
+        input_path(path), shared_owner(std::move(shared_owner)), shared_bytes(shared_bytes) {}
+
+    ByteStorage& BinaryFile::ownedBytes() {
+        unshare();
+
+        return bytes;
+    }
+
+    ByteStorage BinaryFile::makeStorage() const {
+        return ByteStorage(bytes.getResource());
+    }
+
+    void BinaryFile::replaceBytes(ByteStorage&& new_bytes) {
+        bytes = std::move(new_bytes);
+        shared_bytes = {};
+        shared_owner.reset();
+
+        if (provenance.has_value()) {
+            provenance->clear();
+        }
+    }
+
+    std::span<const byte> BinaryFile::readView(size_t offset, size_t byte_count) const {
         const auto ending_byte_offset{ offset + byte_count };
 
-        if (ending_byte_offset > bytes.size()) {
+        const auto view{ getView() };
+
+        if (ending_byte_offset > view.size()) {
             throw BinaryFileException(fmt::format(
                 "Attempt to read binary data from offset 0x{:X} "
                 "to 0x{:X} inclusive, but final valid offset is 0x{:X}",
-                offset, ending_byte_offset - 1, bytes.size() - 1
+                offset, ending_byte_offset - 1, view.size() - 1
             ));
         }
 
-        std::vector<byte> read_bytes{};
-        while (offset != ending_byte_offset) {
-            read_bytes.push_back(bytes.at(offset++));
-        }
+        return view.subspan(offset, byte_count);
+    }
 
-        return read_bytes;
+    std::vector<byte> BinaryFile::read(size_t offset, size_t byte_count) const {
+        const auto view{ readView(offset, byte_count) };
+
+        return std::vector<byte>(view.begin(), view.end());
     }
 
     byte BinaryFile::read1(size_t offset) const {
-        return join(read(offset, 1));
+        return join(readView(offset, 1));
     }
     
     _2bytes BinaryFile::read2(size_t offset) const {
-        return join(read(offset, 2));
+        return join(readView(offset, 2));
     }
 
     _4bytes BinaryFile::read3(size_t offset) const {
-        return join(read(offset, 3));
+        return join(readView(offset, 3));
     }
 
     _4bytes BinaryFile::read4(size_t offset) const {
-        return join(read(offset, 4));
+        return join(readView(offset, 4));
     }
 
-    std::vector<byte> BinaryFile::split(_4bytes bytes, size_t byte_count) {
-        std::vector<byte> split{};
+    std::array<byte, sizeof(_4bytes)> BinaryFile::split(_4bytes bytes, size_t byte_count) {
+        std::array<byte, sizeof(_4bytes)> split{};
 
         size_t i{ 0 };
         while (i != byte_count) {
-            split.push_back((bytes >> (i++ * 8)) & 0xFF);
+            split[i] = (bytes >> (i * 8)) & 0xFF;
+            ++i;
         }
 
         return split;
     }
 
     void BinaryFile::write(size_t offset, const std::vector<byte>& bytes_to_write) {
+        write(offset, std::span<const byte>(bytes_to_write));
+    }
+
+    void BinaryFile::write(size_t offset, std::span<const byte> bytes_to_write) {
         const auto ending_byte_offset{ offset + bytes_to_write.size() };
 
-        if (ending_byte_offset > bytes.size()) {
+        if (ending_byte_offset > getSize()) {
+            if (bytes_to_write.size() > sizeof(_4bytes)) {
+                throw BinaryFileException(fmt::format(
+                    "Attempt to write {} bytes at offset 0x{:X} "
+                    "to 0x{:X} inclusive, but final valid offset is 0x{:X}",
+                    bytes_to_write.size(), offset, ending_byte_offset - 1, getSize() - 1
+                ));
+            }
+
             throw BinaryFileException(fmt::format(
                 "Attempt to write the {} byte(s) 0x{:X} at offset 0x{:X} "
                 "to 0x{:X} inclusive, but final valid offset is 0x{:X}",
-                bytes_to_write.size(), join(bytes_to_write), offset, ending_byte_offset - 1, bytes.size() - 1
+                bytes_to_write.size(), join(bytes_to_write), offset, ending_byte_offset - 1, getSize() - 1
             ));
         }
 
-        size_t i{ 0 };
-        while (offset != ending_byte_offset) {
-            bytes[offset++] = bytes_to_write[i];
+        std::copy(bytes_to_write.begin(), bytes_to_write.end(), ownedBytes().begin() + offset);
+
+        if (provenance.has_value()) {
+            provenance->record(offset, bytes_to_write.size());
         }
     }
 
     void BinaryFile::write1(size_t offset, byte byte) {
-        write(offset, { byte });
+        write(offset, std::span<const binary_file::byte>(&byte, 1));
     }
 
     void BinaryFile::write2(size_t offset, _2bytes bytes_to_write) {
-        write(offset, split(bytes_to_write, 2));
+        const auto split_bytes{ split(bytes_to_write, 2) };
+        write(offset, std::span<const byte>(split_bytes).first(2));
     }
 
     void BinaryFile::write3(size_t offset, _4bytes bytes_to_write) {
-        write(offset, split(bytes_to_write, 3));
+        const auto split_bytes{ split(bytes_to_write, 3) };
+        write(offset, std::span<const byte>(split_bytes).first(3));
     }
 
     void BinaryFile::write4(size_t offset, _4bytes bytes_to_write) {
-        write(offset, split(bytes_to_write, 4));
+        const auto split_bytes{ split(bytes_to_write, 4) };
+        write(offset, std::span<const byte>(split_bytes));
     }
 
     void BinaryFile::outputAt(const fs::path& path) const {
@@ -134,7 +250,8 @@ namespace binary_file {
             ));
         }
 
-        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        const auto view{ getView() };
+        file.write(reinterpret_cast<const char*>(view.data()), view.size());
 
         if (!file) {
             throw BinaryFileException(fmt::format(
@@ -158,4 +275,53 @@ namespace binary_file {
     const std::optional<fs::path>& BinaryFile::getInputPath() const {
         return input_path;
     }
+
+    size_t BinaryFile::getSize() const {
+        return getView().size();
+    }
+
+    std::span<const byte> BinaryFile::getView() const {
+        if (shared_owner) {
+            return shared_bytes;
+        }
+
+        return { bytes.data(), bytes.size() };
+    }
+
+    std::pmr::memory_resource* BinaryFile::getMemoryResource() const {
+        return shared_owner ? nullptr : bytes.getResource();
+    }
+
+    bool BinaryFile::isShared() const {
+        return static_cast<bool>(shared_owner);
+    }
+
+    void BinaryFile::unshare() {
+        if (!shared_owner) {
+            return;
+        }
+
+        bytes.assign(shared_bytes);
+        shared_bytes = {};
+        shared_owner.reset();
+    }
+
+    void BinaryFile::enableProvenance() {
+        if (!provenance.has_value()) {
+            provenance.emplace();
+        }
+    }
+
+    void BinaryFile::disableProvenance() {
+        provenance.reset();
+    }
+
+    void BinaryFile::setWriteOwner(std::string_view owner) {
+        enableProvenance();
+        provenance->setOwner(owner);
+    }
+
+    const std::optional<WriteProvenance>& BinaryFile::getProvenance() const {
+        return provenance;
+    }
 }
@@ -0,0 +1,259 @@
+#include "../include/concurrent_rom.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace binary_file {
+	void ConcurrentRom::PageLock::lock() {
+		while (locked.test_and_set(std::memory_order_acquire)) {
+			while (locked.test(std::memory_order_relaxed)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void ConcurrentRom::PageLock::unlock() {
+		locked.clear(std::memory_order_release);
+	}
+
+	ConcurrentRom::PagesGuard::PagesGuard(const ConcurrentRom& rom, const std::vector<size_t>& page_indices) :
+		rom(rom), page_indices(page_indices) {
+		rom.lockPages(page_indices);
+	}
+
+	ConcurrentRom::PagesGuard::~PagesGuard() {
+		rom.unlockPages(page_indices);
+	}
+
+	ConcurrentRom::Writer::Writer(ConcurrentRom& rom, uint32_t owner) : rom(rom), owner(owner) {}
+
+	void ConcurrentRom::Writer::claim(Address address, size_t byte_count) {
+		std::vector<size_t> page_indices{};
+
+		auto current{ address };
+		while (byte_count != 0) {
+			const auto pc_address{ current.pc() };
+			const auto run{ std::min(byte_count, page_size - (current.snes() & (page_size - 1))) };
+
+			if (pc_address + run > rom.rom.getSize()) {
+				throw BinaryFileException(fmt::format(
+					"Attempt to claim 0x{:X} byte(s) at {}, which runs past the end of the ROM",
+					run, current.string()
+				));
+			}
+
+			for (auto page{ pc_address / page_size }; page <= (pc_address + run - 1) / page_size; ++page) {
+				page_indices.push_back(page);
+			}
+
+			byte_count -= run;
+			if (byte_count != 0) {
+				current += run;
+			}
+		}
+
+		std::sort(page_indices.begin(), page_indices.end());
+		page_indices.erase(std::unique(page_indices.begin(), page_indices.end()), page_indices.end());
+
+		rom.claimPages(page_indices, owner, address);
+	}
+
+	void ConcurrentRom::Writer::write1(Address address, byte byte_to_write) {
+		rom.write(owner, address, byte_to_write, 1);
+	}
+
+	void ConcurrentRom::Writer::write2(Address address, _2bytes bytes_to_write) {
+		rom.write(owner, address, bytes_to_write, 2);
+	}
+
+	void ConcurrentRom::Writer::write3(Address address, _4bytes bytes_to_write) {
+		rom.write(owner, address, bytes_to_write, 3);
+	}
+
+	void ConcurrentRom::Writer::write4(Address address, _4bytes bytes_to_write) {
+		rom.write(owner, address, bytes_to_write, 4);
+	}
+
+	std::string ConcurrentRom::Writer::getName() const {
+		return rom.nameOf(owner);
+	}
+
+	ConcurrentRom::ConcurrentRom(Rom& rom) :
+		rom(rom),
+		page_count((rom.getSize() + page_size - 1) / page_size),
+		pages(std::make_unique<Page[]>(page_count)),
+		records_provenance(rom.getProvenance().has_value()) {
+		rom.ensureMapper();
+		rom.unshare();
+
+		if (records_provenance) {
+			original_owner = rom.getProvenance()->getOwner();
+		}
+	}
+
+	ConcurrentRom::~ConcurrentRom() {
+		if (records_provenance && provenance_owner != 0 && rom.getProvenance().has_value()) {
+			rom.setWriteOwner(original_owner);
+		}
+	}
+
+	ConcurrentRom::Writer ConcurrentRom::writer(std::string_view name) {
+		std::lock_guard lock{ names_mutex };
+
+		names.emplace_back(name);
+
+		return Writer(*this, static_cast<uint32_t>(names.size()));
+	}
+
+	byte ConcurrentRom::read1(Address address) const {
+		return read(address, 1);
+	}
+
+	_2bytes ConcurrentRom::read2(Address address) const {
+		return read(address, 2);
+	}
+
+	_4bytes ConcurrentRom::read3(Address address) const {
+		return read(address, 3);
+	}
+
+	_4bytes ConcurrentRom::read4(Address address) const {
+		return read(address, 4);
+	}
+
+	std::optional<std::string> ConcurrentRom::getOwner(Address address) const {
+		const auto page{ address.pc() / page_size };
+
+		if (page >= page_count) {
+			return std::nullopt;
+		}
+
+		const auto owner{ pages[page].owner.load(std::memory_order_acquire) };
+
+		if (owner == 0) {
+			return std::nullopt;
+		}
+
+		return nameOf(owner);
+	}
+
+	std::vector<size_t> ConcurrentRom::offsetsOf(Address address, size_t byte_count) const {
+		std::vector<size_t> offsets{};
+
+		for (size_t i{ 0 }; i != byte_count; ++i) {
+			const auto pc_address{ (address + i).pc() };
+
+			if (pc_address >= rom.getSize()) {
+				throw BinaryFileException(fmt::format(
+					"Invalid access of {} byte(s) at {}",
+					byte_count, address.string()
+				));
+			}
+
+			offsets.push_back(pc_address);
+		}
+
+		return offsets;
+	}
+
+	std::vector<size_t> ConcurrentRom::pagesOf(const std::vector<size_t>& offsets) const {
+		std::vector<size_t> page_indices{};
+
+		for (const auto offset : offsets) {
+			page_indices.push_back(offset / page_size);
+		}
+
+		std::sort(page_indices.begin(), page_indices.end());
+		page_indices.erase(std::unique(page_indices.begin(), page_indices.end()), page_indices.end());
+
+		return page_indices;
+	}
+
+	void ConcurrentRom::claimPages(const std::vector<size_t>& page_indices, uint32_t owner, Address address) {
+		std::vector<size_t> claimed{};
+
+		for (const auto page : page_indices) {
+			uint32_t expected{ 0 };
+
+			if (pages[page].owner.compare_exchange_strong(expected, owner, std::memory_order_acq_rel)) {
+				claimed.push_back(page);
+			}
+			else if (expected != owner) {
+				// the rejected write must not keep pages it never got to touch from other writers
+				for (const auto claimed_page : claimed) {
+					auto claimed_owner{ owner };
+					pages[claimed_page].owner.compare_exchange_strong(claimed_owner, 0, std::memory_order_acq_rel);
+				}
+
+				throw WriteConflictException(fmt::format(
+					"Writer '{}' cannot write to {}, page 0x{:06X}-0x{:06X} is owned by writer '{}'",
+					nameOf(owner), address.string(), page * page_size, (page + 1) * page_size - 1, nameOf(expected)
+				));
+			}
+		}
+	}
+
+	// pages are always locked in ascending order so accesses spanning two pages cannot deadlock
+	void ConcurrentRom::lockPages(const std::vector<size_t>& page_indices) const {
+		for (const auto page : page_indices) {
+			pages[page].lock.lock();
+		}
+	}
+
+	void ConcurrentRom::unlockPages(const std::vector<size_t>& page_indices) const {
+		for (const auto page : page_indices) {
+			pages[page].lock.unlock();
+		}
+	}
+
+	_4bytes ConcurrentRom::read(Address address, size_t byte_count) const {
+		const auto offsets{ offsetsOf(address, byte_count) };
+		const auto page_indices{ pagesOf(offsets) };
+
+		_4bytes read_bytes{ 0 };
+
+		const PagesGuard guard{ *this, page_indices };
+		for (size_t i{ 0 }; i != byte_count; ++i) {
+			read_bytes |= static_cast<_4bytes>(rom.BinaryFile::read1(offsets[i])) << (i * 8);
+		}
+
+		return read_bytes;
+	}
+
+	void ConcurrentRom::write(uint32_t owner, Address address, _4bytes bytes_to_write, size_t byte_count) {
+		const auto offsets{ offsetsOf(address, byte_count) };
+		const auto page_indices{ pagesOf(offsets) };
+
+		claimPages(page_indices, owner, address);
+
+		const PagesGuard guard{ *this, page_indices };
+
+		if (!records_provenance) {
+			writeBytes(offsets, bytes_to_write);
+			return;
+		}
+
+		std::lock_guard lock{ provenance_mutex };
+
+		if (provenance_owner != owner) {
+			std::lock_guard names_lock{ names_mutex };
+
+			rom.setWriteOwner(names[owner - 1]);
+			provenance_owner = owner;
+		}
+
+		writeBytes(offsets, bytes_to_write);
+	}
+
+	void ConcurrentRom::writeBytes(const std::vector<size_t>& offsets, _4bytes bytes_to_write) {
+		for (size_t i{ 0 }; i != offsets.size(); ++i) {
+			rom.BinaryFile::write1(offsets[i], (bytes_to_write >> (i * 8)) & 0xFF);
+		}
+	}
+
+	std::string ConcurrentRom::nameOf(uint32_t owner) const {
+		std::lock_guard lock{ names_mutex };
+
+		return names.at(owner - 1);
+	}
+}
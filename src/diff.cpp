@@ -0,0 +1,160 @@
+#include "../include/diff.h"
+
+#include <bit>
+#include <cstring>
+
+#include "simd.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t block_size{ 64 };
+		constexpr size_t min_blocks_per_thread{ (1 << 20) / block_size };
+
+		// bit i is set if lhs[i] != rhs[i]
+		uint64_t differingBytes(const byte* lhs, const byte* rhs) {
+#if defined(BINARY_FILE_AVX2)
+			const auto low{ _mm256_cmpeq_epi8(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs))
+			) };
+			const auto high{ _mm256_cmpeq_epi8(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + 32)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + 32))
+			) };
+
+			const uint64_t equal{
+				static_cast<uint32_t>(_mm256_movemask_epi8(low)) |
+				static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high))) << 32
+			};
+
+			return ~equal;
+#elif defined(BINARY_FILE_SSE2)
+			uint64_t equal{ 0 };
+
+			for (size_t i{ 0 }; i != block_size; i += 16) {
+				const auto same{ _mm_cmpeq_epi8(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i))
+				) };
+
+				equal |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(same))) << i;
+			}
+
+			return ~equal;
+#else
+			if (std::memcmp(lhs, rhs, block_size) == 0) {
+				return 0;
+			}
+
+			uint64_t differing{ 0 };
+
+			for (size_t i{ 0 }; i != block_size; ++i) {
+				differing |= static_cast<uint64_t>(lhs[i] != rhs[i]) << i;
+			}
+
+			return differing;
+#endif
+		}
+
+		void appendRange(std::vector<DiffRange>& ranges, size_t offset, size_t length, size_t merge_gap) {
+			if (!ranges.empty()) {
+				auto& last{ ranges.back() };
+				const auto last_end{ last.offset + last.length };
+
+				if (offset - last_end <= merge_gap) {
+					last.length = offset + length - last.offset;
+					return;
+				}
+			}
+
+			ranges.push_back({ offset, length });
+		}
+
+		void appendMask(std::vector<DiffRange>& ranges, size_t base, uint64_t differing, size_t merge_gap) {
+			size_t bit{ 0 };
+
+			while (differing != 0) {
+				const auto start{ static_cast<size_t>(std::countr_zero(differing)) };
+				differing >>= start;
+				bit += start;
+
+				const auto length{ static_cast<size_t>(std::countr_one(differing)) };
+				appendRange(ranges, base + bit, length, merge_gap);
+
+				if (length == 64) {
+					break;
+				}
+
+				differing >>= length;
+				bit += length;
+			}
+		}
+
+		void diffBlocks(const byte* lhs, const byte* rhs, size_t first_block, size_t last_block,
+			size_t merge_gap, std::vector<DiffRange>& ranges) {
+			for (size_t block{ first_block }; block != last_block; ++block) {
+				const auto offset{ block * block_size };
+				const auto differing{ differingBytes(lhs + offset, rhs + offset) };
+
+				if (differing != 0) {
+					appendMask(ranges, offset, differing, merge_gap);
+				}
+			}
+		}
+	}
+
+	std::vector<DiffRange> diff(const BinaryFile& lhs, const BinaryFile& rhs, size_t merge_gap) {
+		const auto left{ lhs.getView() };
+		const auto right{ rhs.getView() };
+
+		const auto common{ std::min(left.size(), right.size()) };
+		const auto full_blocks{ common / block_size };
+
+		std::vector<std::vector<DiffRange>> partial(workerCount(full_blocks, min_blocks_per_thread));
+
+		parallelFor(full_blocks, min_blocks_per_thread, [&](size_t task, size_t begin, size_t end) {
+			diffBlocks(left.data(), right.data(), begin, end, merge_gap, partial[task]);
+		});
+
+		std::vector<DiffRange> ranges{};
+
+		for (const auto& task_ranges : partial) {
+			for (const auto& range : task_ranges) {
+				appendRange(ranges, range.offset, range.length, merge_gap);
+			}
+		}
+
+		for (size_t offset{ full_blocks * block_size }; offset != common; ++offset) {
+			if (left[offset] != right[offset]) {
+				appendRange(ranges, offset, 1, merge_gap);
+			}
+		}
+
+		if (left.size() != right.size()) {
+			appendRange(ranges, common, std::max(left.size(), right.size()) - common, merge_gap);
+		}
+
+		return ranges;
+	}
+
+	std::vector<RomDiffRange> diff(Rom& lhs, Rom& rhs, size_t merge_gap) {
+		lhs.ensureMapper();
+		rhs.ensureMapper();
+
+		const auto mapper{ lhs.getMapper().value() };
+		const auto sa1_banks{ lhs.getSa1Banks() };
+
+		if (rhs.getMapper().value() != mapper || rhs.getSa1Banks() != sa1_banks) {
+			throw BinaryFileException("Cannot diff roms with different mappers or SA-1 banks");
+		}
+
+		std::vector<RomDiffRange> annotated{};
+
+		for (const auto& range : diff(static_cast<const BinaryFile&>(lhs), static_cast<const BinaryFile&>(rhs), merge_gap)) {
+			annotated.push_back({ Address::PC(range.offset, mapper, sa1_banks), range.length });
+		}
+
+		return annotated;
+	}
+}
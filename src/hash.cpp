@@ -0,0 +1,131 @@
+#include "../include/hash.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace binary_file {
+	namespace {
+		constexpr uint64_t prime1{ 0x9E3779B185EBCA87 };
+		constexpr uint64_t prime2{ 0xC2B2AE3D27D4EB4F };
+		constexpr uint64_t prime3{ 0x165667B19E3779F9 };
+		constexpr uint64_t prime4{ 0x85EBCA77C2B2AE63 };
+		constexpr uint64_t prime5{ 0x27D4EB2F165667C5 };
+
+		// slicing-by-8, crc_tables[k][b] is the crc of byte b followed by k zero bytes
+		constexpr auto crc_tables{ [] {
+			std::array<std::array<uint32_t, 256>, 8> tables{};
+
+			for (uint32_t value{ 0 }; value != 256; ++value) {
+				auto crc{ value };
+
+				for (size_t bit{ 0 }; bit != 8; ++bit) {
+					crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+				}
+
+				tables[0][value] = crc;
+			}
+
+			for (size_t table{ 1 }; table != tables.size(); ++table) {
+				for (size_t value{ 0 }; value != 256; ++value) {
+					const auto previous{ tables[table - 1][value] };
+					tables[table][value] = (previous >> 8) ^ tables[0][previous & 0xFF];
+				}
+			}
+
+			return tables;
+		}() };
+
+		uint64_t load64(const byte* data) {
+			uint64_t value{};
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t load32(const byte* data) {
+			uint32_t value{};
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint64_t round(uint64_t accumulator, uint64_t input) {
+			return std::rotl(accumulator + input * prime2, 31) * prime1;
+		}
+
+		uint64_t mergeRound(uint64_t accumulator, uint64_t lane) {
+			return (accumulator ^ round(0, lane)) * prime1 + prime4;
+		}
+	}
+
+	uint64_t hash64(std::span<const byte> bytes, uint64_t seed) {
+		auto data{ bytes.data() };
+		const auto end{ data + bytes.size() };
+
+		uint64_t hash{};
+
+		if (bytes.size() >= 32) {
+			uint64_t lanes[4]{ seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+
+			for (; end - data >= 32; data += 32) {
+				for (size_t lane{ 0 }; lane != 4; ++lane) {
+					lanes[lane] = round(lanes[lane], load64(data + lane * 8));
+				}
+			}
+
+			hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+
+			for (const auto lane : lanes) {
+				hash = mergeRound(hash, lane);
+			}
+		}
+		else {
+			hash = seed + prime5;
+		}
+
+		hash += bytes.size();
+
+		for (; end - data >= 8; data += 8) {
+			hash = std::rotl(hash ^ round(0, load64(data)), 27) * prime1 + prime4;
+		}
+
+		if (end - data >= 4) {
+			hash = std::rotl(hash ^ (load32(data) * prime1), 23) * prime2 + prime3;
+			data += 4;
+		}
+
+		for (; data != end; ++data) {
+			hash = std::rotl(hash ^ (*data * prime5), 11) * prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	uint32_t crc32(std::span<const byte> bytes, uint32_t crc) {
+		auto data{ bytes.data() };
+		const auto end{ data + bytes.size() };
+
+		crc = ~crc;
+
+		for (; end - data >= 8; data += 8) {
+			const auto low{ load32(data) ^ crc };
+			const auto high{ load32(data + 4) };
+
+			crc = crc_tables[7][low & 0xFF] ^ crc_tables[6][(low >> 8) & 0xFF] ^
+				crc_tables[5][(low >> 16) & 0xFF] ^ crc_tables[4][low >> 24] ^
+				crc_tables[3][high & 0xFF] ^ crc_tables[2][(high >> 8) & 0xFF] ^
+				crc_tables[1][(high >> 16) & 0xFF] ^ crc_tables[0][high >> 24];
+		}
+
+		for (; data != end; ++data) {
+			crc = (crc >> 8) ^ crc_tables[0][(crc ^ *data) & 0xFF];
+		}
+
+		return ~crc;
+	}
+}
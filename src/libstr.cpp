@@ -1,5 +1,9 @@
 #include "../include/libstr.h"
 
+#include <bit>
+
+#include "simd.h"
+
 namespace binary_file {
 	extern const unsigned char char_props[256] = {
 		//x0   x1   x2   x3   x4   x5   x6   x7   x8   x9   xA   xB   xC   xD   xE   xF
@@ -20,4 +24,126 @@ namespace binary_file {
 		0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // Ex
 		0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // Fx
 	};
+
+	namespace {
+#if defined(BINARY_FILE_SSE2)
+		__m128i in_range(__m128i c, char low, char high) {
+			return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8(high + 1)));
+		}
+
+		__m128i classify(__m128i c, char_class cls) {
+			const auto folded{ _mm_or_si128(c, _mm_set1_epi8(0x20)) };
+
+			switch (cls) {
+			case char_class::space:
+				return _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+					_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\r')))
+				);
+
+			case char_class::digit:
+				return in_range(c, '0', '9');
+
+			case char_class::xdigit:
+				return _mm_or_si128(in_range(c, '0', '9'), in_range(folded, 'a', 'f'));
+
+			case char_class::ualnum:
+			default:
+				return _mm_or_si128(
+					_mm_or_si128(in_range(c, '0', '9'), in_range(folded, 'a', 'z')),
+					_mm_cmpeq_epi8(c, _mm_set1_epi8('_'))
+				);
+			}
+		}
+#endif
+
+#if defined(BINARY_FILE_AVX2)
+		__m256i in_range(__m256i c, char low, char high) {
+			return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), c));
+		}
+
+		__m256i classify(__m256i c, char_class cls) {
+			const auto folded{ _mm256_or_si256(c, _mm256_set1_epi8(0x20)) };
+
+			switch (cls) {
+			case char_class::space:
+				return _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'))),
+					_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\r')))
+				);
+
+			case char_class::digit:
+				return in_range(c, '0', '9');
+
+			case char_class::xdigit:
+				return _mm256_or_si256(in_range(c, '0', '9'), in_range(folded, 'a', 'f'));
+
+			case char_class::ualnum:
+			default:
+				return _mm256_or_si256(
+					_mm256_or_si256(in_range(c, '0', '9'), in_range(folded, 'a', 'z')),
+					_mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'))
+				);
+			}
+		}
+#endif
+	}
+
+	uint16_t class_mask16(const char* block, char_class cls) {
+#if defined(BINARY_FILE_SSE2)
+		return static_cast<uint16_t>(_mm_movemask_epi8(classify(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), cls)));
+#else
+		uint16_t mask{ 0 };
+
+		for (unsigned i{ 0 }; i != 16; ++i) {
+			mask |= static_cast<uint16_t>(is_class(block[i], cls)) << i;
+		}
+
+		return mask;
+#endif
+	}
+
+	uint32_t class_mask32(const char* block, char_class cls) {
+#if defined(BINARY_FILE_AVX2)
+		return static_cast<uint32_t>(_mm256_movemask_epi8(classify(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), cls)));
+#else
+		return class_mask16(block, cls) | static_cast<uint32_t>(class_mask16(block + 16, cls)) << 16;
+#endif
+	}
+
+	const char* find_class(const char* begin, const char* end, char_class cls) {
+#if defined(BINARY_FILE_SSE2)
+		for (; end - begin >= 32; begin += 32) {
+			const auto mask{ class_mask32(begin, cls) };
+
+			if (mask != 0) {
+				return begin + std::countr_zero(mask);
+			}
+		}
+#endif
+
+		while (begin != end && !is_class(*begin, cls)) {
+			++begin;
+		}
+
+		return begin;
+	}
+
+	const char* skip_class(const char* begin, const char* end, char_class cls) {
+#if defined(BINARY_FILE_SSE2)
+		for (; end - begin >= 32; begin += 32) {
+			const auto mask{ ~class_mask32(begin, cls) };
+
+			if (mask != 0) {
+				return begin + std::countr_zero(mask);
+			}
+		}
+#endif
+
+		while (begin != end && is_class(*begin, cls)) {
+			++begin;
+		}
+
+		return begin;
+	}
 }
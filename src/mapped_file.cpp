@@ -0,0 +1,117 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace binary_file {
+#ifdef _WIN32
+	MappedFile::MappedFile(const fs::path& path) {
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE) {
+			file = nullptr;
+			throw BinaryFileException(fmt::format(
+				"Failed to open {} for reading",
+				path.string()
+			));
+		}
+
+		LARGE_INTEGER file_size{};
+		GetFileSizeEx(file, &file_size);
+		size = static_cast<size_t>(file_size.QuadPart);
+
+		if (size == 0) {
+			return;
+		}
+
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			data = static_cast<const byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+
+		if (data == nullptr) {
+			if (mapping != nullptr) {
+				CloseHandle(mapping);
+			}
+
+			CloseHandle(file);
+			throw BinaryFileException(fmt::format(
+				"Failed to map {} into memory",
+				path.string()
+			));
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (data != nullptr) {
+			UnmapViewOfFile(data);
+			data = nullptr;
+		}
+
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+
+		if (file != nullptr) {
+			CloseHandle(file);
+			file = nullptr;
+		}
+	}
+#else
+	MappedFile::MappedFile(const fs::path& path) {
+		const auto descriptor{ open(path.c_str(), O_RDONLY) };
+
+		if (descriptor == -1) {
+			throw BinaryFileException(fmt::format(
+				"Failed to open {} for reading",
+				path.string()
+			));
+		}
+
+		size = static_cast<size_t>(lseek(descriptor, 0, SEEK_END));
+
+		if (size != 0) {
+#ifdef MAP_POPULATE
+			constexpr int flags{ MAP_PRIVATE | MAP_POPULATE };
+#else
+			constexpr int flags{ MAP_PRIVATE };
+#endif
+			const auto mapped{ mmap(nullptr, size, PROT_READ, flags, descriptor, 0) };
+
+			if (mapped == MAP_FAILED) {
+				close(descriptor);
+				throw BinaryFileException(fmt::format(
+					"Failed to map {} into memory",
+					path.string()
+				));
+			}
+
+			data = static_cast<const byte*>(mapped);
+		}
+
+		close(descriptor);
+	}
+
+	MappedFile::~MappedFile() {
+		if (data != nullptr) {
+			munmap(const_cast<byte*>(data), size);
+		}
+	}
+#endif
+
+	std::span<const byte> MappedFile::getBytes() const {
+		return { data, size };
+	}
+
+	std::string_view MappedFile::getText() const {
+		return { reinterpret_cast<const char*>(data), size };
+	}
+}
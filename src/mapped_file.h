@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "../include/binary_file.h"
+
+namespace fs = std::filesystem;
+
+namespace binary_file {
+	// read-only memory mapping of a whole file, unmapped on destruction
+	class MappedFile {
+	public:
+		MappedFile(const fs::path& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		std::span<const byte> getBytes() const;
+		std::string_view getText() const;
+
+	private:
+		const byte* data{ nullptr };
+		size_t size{ 0 };
+
+#ifdef _WIN32
+		void* file{ nullptr };
+		void* mapping{ nullptr };
+#endif
+	};
+}
+
+#endif // MAPPED_FILE_H
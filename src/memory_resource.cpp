@@ -0,0 +1,139 @@
+#include "../include/memory_resource.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace binary_file {
+	namespace {
+		size_t roundToHugePages(size_t bytes) {
+			return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+		}
+
+		class HugePageResource : public std::pmr::memory_resource {
+		protected:
+			void* do_allocate(size_t bytes, size_t alignment) override {
+				if (alignment > huge_page_size) {
+					throw std::bad_alloc();
+				}
+
+				const auto size{ roundToHugePages(std::max<size_t>(bytes, 1)) };
+
+#ifdef _WIN32
+				// large pages need SeLockMemoryPrivilege, without it this fails and normal pages are used
+				const auto large_page_size{ GetLargePageMinimum() };
+				void* pointer{ nullptr };
+
+				if (large_page_size != 0 && size % large_page_size == 0) {
+					pointer = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				}
+
+				if (pointer == nullptr) {
+					pointer = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+				}
+
+				if (pointer == nullptr) {
+					throw std::bad_alloc();
+				}
+
+				return pointer;
+#else
+#ifdef MAP_HUGETLB
+				// only succeeds if huge pages were reserved through vm.nr_hugepages
+				auto pointer{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0) };
+
+				if (pointer != MAP_FAILED) {
+					return pointer;
+				}
+#endif
+
+				// map one huge page more than needed and trim it so the range starts on a huge page boundary
+				const auto mapped{ static_cast<char*>(mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) };
+
+				if (mapped == MAP_FAILED) {
+					throw std::bad_alloc();
+				}
+
+				const auto aligned{ reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(mapped) + huge_page_size - 1) & ~(huge_page_size - 1)) };
+
+				if (aligned != mapped) {
+					munmap(mapped, aligned - mapped);
+				}
+
+				munmap(aligned + size, mapped + huge_page_size - aligned);
+
+#ifdef MADV_HUGEPAGE
+				madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+				// fault everything in now instead of on first use
+				for (size_t offset{ 0 }; offset < size; offset += 0x1000) {
+					aligned[offset] = 0;
+				}
+
+				return aligned;
+#endif
+			}
+
+			void do_deallocate(void* pointer, size_t bytes, size_t) override {
+#ifdef _WIN32
+				static_cast<void>(bytes);
+				VirtualFree(pointer, 0, MEM_RELEASE);
+#else
+				munmap(pointer, roundToHugePages(std::max<size_t>(bytes, 1)));
+#endif
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+				return this == &other;
+			}
+		};
+	}
+
+	std::pmr::memory_resource* hugePageResource() {
+		static HugePageResource resource{};
+		return &resource;
+	}
+
+	ArenaResource::ArenaResource(size_t capacity, std::pmr::memory_resource* upstream) :
+		upstream(upstream), capacity(capacity), block(upstream->allocate(capacity, alignof(std::max_align_t))),
+		arena(block, capacity, upstream) {}
+
+	ArenaResource::~ArenaResource() {
+		arena.release();
+		upstream->deallocate(block, capacity, alignof(std::max_align_t));
+	}
+
+	void ArenaResource::release() {
+		arena.release();
+		used = 0;
+	}
+
+	size_t ArenaResource::getUsed() const {
+		return used;
+	}
+
+	size_t ArenaResource::getCapacity() const {
+		return capacity;
+	}
+
+	void* ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+		const auto pointer{ arena.allocate(bytes, alignment) };
+		used += bytes;
+		return pointer;
+	}
+
+	void ArenaResource::do_deallocate(void*, size_t, size_t) {}
+
+	bool ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+		return this == &other;
+	}
+}
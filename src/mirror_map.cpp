@@ -0,0 +1,143 @@
+#include "../include/mirror_map.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t block_shift{ 15 };
+		constexpr size_t block_offset_mask{ MirrorMap::block_size - 1 };
+		constexpr size_t min_addresses_per_task{ 0x10000 };
+		constexpr size_t address_limit{ 0x1000000 };
+	}
+
+	MirrorMap::MirrorMap(Mapper mapper, Sa1Banks sa1_banks) :
+		mapper(mapper), sa1_banks(sa1_banks), mirror_blocks(block_count) {
+		for (size_t block{ 0 }; block != block_count; ++block) {
+			const auto address{ Address::SNES(block << block_shift, mapper, sa1_banks) };
+
+			if (!address.hasPc()) {
+				blocks[block] = { unmapped, unmapped };
+				continue;
+			}
+
+			const auto pc_base{ address.pc() };
+			const auto canonical{ Address::PC(pc_base, mapper, sa1_banks) };
+
+			// every mapper maps rom in runs of at least 32 KiB, so the block base stands for the block
+			blocks[block] = {
+				static_cast<uint32_t>(pc_base),
+				static_cast<uint32_t>(canonical.hasSnes() ? canonical.snes() : block << block_shift)
+			};
+
+			mirror_blocks[pc_base >> block_shift].push_back(static_cast<uint16_t>(block));
+		}
+	}
+
+	std::optional<size_t> MirrorMap::toPc(size_t snes_address) const {
+		if (snes_address >= address_limit) {
+			return std::nullopt;
+		}
+
+		const auto& block{ blocks[snes_address >> block_shift] };
+
+		if (block.pc_base == unmapped) {
+			return std::nullopt;
+		}
+
+		return block.pc_base + (snes_address & block_offset_mask);
+	}
+
+	std::optional<size_t> MirrorMap::canonicalize(size_t snes_address) const {
+		if (snes_address >= address_limit) {
+			return std::nullopt;
+		}
+
+		const auto& block{ blocks[snes_address >> block_shift] };
+
+		if (block.canonical_base == unmapped) {
+			return std::nullopt;
+		}
+
+		return block.canonical_base + (snes_address & block_offset_mask);
+	}
+
+	Address MirrorMap::canonicalize(Address address) const {
+		const auto canonical{ canonicalize(address.snes()) };
+
+		if (!canonical.has_value()) {
+			return address;
+		}
+
+		return Address::SNES(canonical.value(), mapper, sa1_banks);
+	}
+
+	std::vector<size_t> MirrorMap::canonicalize(std::span<const size_t> snes_addresses) const {
+		std::vector<size_t> canonical(snes_addresses.size());
+
+		parallelFor(snes_addresses.size(), min_addresses_per_task, [&](size_t, size_t begin, size_t end) {
+			for (auto i{ begin }; i != end; ++i) {
+				canonical[i] = canonicalize(snes_addresses[i]).value_or(snes_addresses[i]);
+			}
+		});
+
+		return canonical;
+	}
+
+	std::vector<size_t> MirrorMap::mirrorsOf(size_t pc_address) const {
+		std::vector<size_t> mirrors{};
+
+		if (pc_address >= address_limit) {
+			return mirrors;
+		}
+
+		for (const auto block : mirror_blocks[pc_address >> block_shift]) {
+			mirrors.push_back(static_cast<size_t>(block) << block_shift | (pc_address & block_offset_mask));
+		}
+
+		return mirrors;
+	}
+
+	std::vector<SnesRange> MirrorMap::mirrorsOf(size_t pc_address, size_t length) const {
+		std::vector<SnesRange> ranges{};
+
+		const auto end{ std::min(pc_address + length, address_limit) };
+
+		for (auto position{ pc_address }; position < end;) {
+			const auto run{ std::min(block_size - (position & block_offset_mask), end - position) };
+
+			for (const auto block : mirror_blocks[position >> block_shift]) {
+				ranges.push_back({ static_cast<size_t>(block) << block_shift | (position & block_offset_mask), run });
+			}
+
+			position += run;
+		}
+
+		std::sort(ranges.begin(), ranges.end(), [](const SnesRange& lhs, const SnesRange& rhs) {
+			return lhs.snes_address < rhs.snes_address;
+		});
+
+		// neighbouring blocks that show neighbouring rom, like a HiROM bank, become one range
+		std::vector<SnesRange> merged{};
+		for (const auto& range : ranges) {
+			if (!merged.empty() && merged.back().snes_address + merged.back().length == range.snes_address &&
+				toPc(range.snes_address) == toPc(merged.back().snes_address).value() + merged.back().length) {
+				merged.back().length += range.length;
+			}
+			else {
+				merged.push_back(range);
+			}
+		}
+
+		return merged;
+	}
+
+	Mapper MirrorMap::getMapper() const {
+		return mapper;
+	}
+
+	Sa1Banks MirrorMap::getSa1Banks() const {
+		return sa1_banks;
+	}
+}
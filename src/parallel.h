@@ -0,0 +1,63 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace binary_file {
+	inline size_t workerCount(size_t count, size_t min_per_task) {
+		const size_t hardware{ std::max<size_t>(std::thread::hardware_concurrency(), 1) };
+		const size_t wanted{ min_per_task == 0 ? count : count / min_per_task };
+
+		return std::clamp<size_t>(wanted, 1, hardware);
+	}
+
+	// splits [0, count) into at most one contiguous slice per hardware thread and calls
+	// function(task_index, begin, end) for each, the last slice runs on the calling thread
+	template<typename Function>
+	void parallelFor(size_t count, size_t min_per_task, Function&& function) {
+		const size_t tasks{ workerCount(count, min_per_task) };
+
+		if (tasks == 1) {
+			function(size_t{ 0 }, size_t{ 0 }, count);
+			return;
+		}
+
+		std::exception_ptr error{};
+		std::mutex error_mutex{};
+
+		const auto run{ [&](size_t task) {
+			try {
+				function(task, count * task / tasks, count * (task + 1) / tasks);
+			}
+			catch (...) {
+				std::lock_guard lock{ error_mutex };
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		} };
+
+		std::vector<std::thread> threads{};
+		threads.reserve(tasks - 1);
+
+		for (size_t task{ 0 }; task != tasks - 1; ++task) {
+			threads.emplace_back(run, task);
+		}
+
+		run(tasks - 1);
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+#endif // PARALLEL_H
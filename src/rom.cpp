@@ -1,32 +1,259 @@
 #include "../include/rom.h"
 
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+#include "shared_rom_cache.h"
+
 namespace binary_file {
+	namespace {
+		constexpr size_t page_size{ 0x8000 };
+		constexpr size_t boot_page_snes_address{ 0x008000 };
+		constexpr size_t header_snes_address{ 0x00FFC0 };
+
+		// offsets into the header at $FFC0, the title, map mode, chip, size and checksum bytes all sit
+		// in its first 0x20 bytes
+		constexpr size_t header_size{ 0x20 };
+		constexpr size_t map_mode_offset{ 0x15 };
+		constexpr size_t chip_offset{ 0x16 };
+		constexpr size_t rom_size_offset{ 0x17 };
+		constexpr size_t checksum_complement_offset{ 0x1C };
+		constexpr size_t checksum_offset{ 0x1E };
+
+		// the mappers deriveMapper tells apart by where their header sits, SA-1 shares LoROM's
+		constexpr std::array<Mapper, 4> header_mappers{
+			Mapper::LO_ROM,
+			Mapper::HI_ROM,
+			Mapper::EX_LO_ROM,
+			Mapper::EX_HI_ROM
+		};
+
+		constexpr std::array<size_t, 7> standard_rom_sizes{
+			0x080000, 0x100000, 0x200000, 0x300000, 0x400000, 0x600000, 0x800000
+		};
+
+		size_t maxRomSize(Mapper mapper) {
+			switch (mapper) {
+			case Mapper::LO_ROM:
+			case Mapper::HI_ROM:
+				return 0x400000;
+
+			case Mapper::SFX_ROM:
+				return 0x200000;
+
+			case Mapper::EX_LO_ROM:
+			case Mapper::EX_HI_ROM:
+			case Mapper::SA1_ROM:
+			case Mapper::BIG_SA1_ROM:
+				return 0x800000;
+
+			case Mapper::NO_ROM:
+			default:
+				return 0x1000000;
+			}
+		}
+
+		// low nibble of the $FFD5 map mode byte
+		byte mapModeOf(Mapper mapper) {
+			switch (mapper) {
+			case Mapper::HI_ROM:
+				return 0x01;
+
+			case Mapper::EX_LO_ROM:
+				return 0x02;
+
+			case Mapper::SA1_ROM:
+			case Mapper::BIG_SA1_ROM:
+				return 0x03;
+
+			case Mapper::EX_HI_ROM:
+				return 0x05;
+
+			case Mapper::LO_ROM:
+			case Mapper::SFX_ROM:
+			case Mapper::NO_ROM:
+			default:
+				return 0x00;
+			}
+		}
+
+		// $FFD7 holds the rom size as log2 of the size in KiB, rounded up
+		byte romSizeByteOf(size_t size) {
+			byte size_byte{ 0 };
+
+			while ((size_t{ 0x400 } << size_byte) < size) {
+				++size_byte;
+			}
+
+			return size_byte;
+		}
+
+		// the 16 bit sum of every byte, a size that isn't a power of two counts its last part repeated up
+		// to the next power of two the way the cartridge mirrors it
+		_2bytes checksumOf(std::span<const byte> bytes) {
+			const auto base_size{ std::bit_floor(bytes.size()) };
+			const auto sum{ [](std::span<const byte> part) {
+				return std::accumulate(part.begin(), part.end(), size_t{ 0 });
+			} };
+
+			auto checksum{ sum(bytes.first(base_size)) };
+			const auto rest{ bytes.subspan(base_size) };
+
+			if (!rest.empty()) {
+				checksum += sum(rest) * (base_size / rest.size()) + sum(rest.first(base_size % rest.size()));
+			}
+
+			return static_cast<_2bytes>(checksum);
+		}
+
+		struct PageMove {
+			size_t source;
+			size_t destination;
+			size_t length;
+		};
+	}
+
 	Rom::Rom(const fs::path& path) : BinaryFile(path) {}
 	Rom::Rom(const fs::path& path, Mapper mapper) : BinaryFile(path), mapper(mapper) {}
 
 	Rom::Rom(std::vector<byte>&& bytes) : BinaryFile(std::move(bytes)) {}
 	Rom::Rom(std::vector<byte>&& bytes, Mapper mapper) : BinaryFile(std::move(bytes)), mapper(mapper) {}
 
+	Rom::Rom(const fs::path& path, std::pmr::memory_resource* resource) : BinaryFile(path, resource) {}
+	Rom::Rom(const fs::path& path, Mapper mapper, std::pmr::memory_resource* resource) :
+		BinaryFile(path, resource), mapper(mapper) {}
+
+	Rom::Rom(std::pmr::vector<byte>&& bytes) : BinaryFile(std::move(bytes)) {}
+	Rom::Rom(std::pmr::vector<byte>&& bytes, Mapper mapper) : BinaryFile(std::move(bytes)), mapper(mapper) {}
+
+	Rom::Rom(const fs::path& path, std::shared_ptr<const void> shared_owner, std::span<const byte> shared_bytes,
+		std::optional<Mapper> mapper, Sa1Banks sa1_banks) :
+		BinaryFile(path, std::move(shared_owner), shared_bytes), mapper(mapper), sa1_banks(sa1_banks) {}
+
+	Rom Rom::openShared(const fs::path& path) {
+		auto segment{ attachSharedRom(path) };
+
+		if (segment.has_value()) {
+			return Rom(path, std::move(segment->owner), segment->bytes, segment->mapper, segment->sa1_banks);
+		}
+
+		// taken before reading so a write racing the load makes the published copy stale instead of wrong
+		const auto identity{ identityOf(path) };
+
+		Rom rom(path);
+		rom.ensureMapper();
+
+		if (identity.has_value()) {
+			publishSharedRom(path, identity.value(), rom.getView(), rom.mapper, rom.sa1_banks);
+		}
+
+		return rom;
+	}
+
+	void Rom::dropShared(const fs::path& path) {
+		unlinkSharedRom(path);
+	}
+
+	Rom Rom::openIndexed(const fs::path& path) {
+		// taken before reading so a write racing the load makes the saved index stale instead of wrong
+		std::error_code error{};
+		const auto mtime{ fs::last_write_time(path, error) };
+
+		Rom rom(path);
+		auto loaded{ RomIndex::load(path, rom.getView()) };
+
+		if (loaded.has_value()) {
+			rom.mapper = loaded->mapper;
+			rom.sa1_banks = loaded->sa1_banks;
+			rom.index = std::move(loaded);
+			return rom;
+		}
+
+		rom.rebuildIndex();
+
+		if (!error) {
+			try {
+				rom.index->save(path, mtime);
+			}
+			catch (const BinaryFileException&) {
+				// read-only directories just don't get an index
+			}
+		}
+
+		return rom;
+	}
+
+	const RomIndex& Rom::getIndex() {
+		if (!index.has_value()) {
+			rebuildIndex();
+		}
+
+		return index.value();
+	}
+
+	void Rom::rebuildIndex() {
+		ensureMapper();
+
+		index = RomIndex::build(getView(), mapper, sa1_banks);
+	}
+
+	RomHeader Rom::getHeader() {
+		const auto header_bytes{ BinaryFile::read(snes(header_snes_address).pc(), RomHeader::size) };
+
+		return RomHeader::fromBytes(std::span<const byte, RomHeader::size>(header_bytes.data(), RomHeader::size));
+	}
+
+	UsageMap Rom::analyzeUsage(const UsageHeuristics& heuristics) {
+		ensureMapper();
+
+		return binary_file::analyzeUsage(getView(), mapper.value(), sa1_banks, heuristics);
+	}
+
 	void Rom::ensureMapper() {
 		if (!mapper.has_value()) {
 			deriveMapper();
 		}
 	}
 
+	std::vector<WriteRecord> Rom::ownersOf(Address address, size_t byte_count) const {
+		std::vector<WriteRecord> records{};
+
+		if (!provenance.has_value()) {
+			return records;
+		}
+
+		for (const auto& [offset, length] : runsOf(address, byte_count)) {
+			for (auto& record : provenance->ownersOf(offset, length)) {
+				if (!records.empty() && records.back().offset + records.back().length == record.offset &&
+					records.back().owner == record.owner) {
+					records.back().length += record.length;
+				}
+				else {
+					records.push_back(std::move(record));
+				}
+			}
+		}
+
+		return records;
+	}
+
 	Address Rom::pc(size_t pc_address) {
 		ensureMapper();
 
-		return Address::PC(pc_address, mapper.value());
+		return Address::PC(pc_address, mapper.value(), sa1_banks);
 	}
 
 	Address Rom::snes(size_t snes_address) {
 		ensureMapper();
 
-		return Address::SNES(snes_address, mapper.value());
+		return Address::SNES(snes_address, mapper.value(), sa1_banks);
 	}
 
 	std::vector<byte> Rom::getBytes() {
-		return bytes;
+		const auto view{ getView() };
+
+		return std::vector<byte>(view.begin(), view.end());
 	}
 
 	std::optional<Mapper> Rom::getMapper() const {
@@ -35,6 +262,16 @@ namespace binary_file {
 
 	void Rom::setMapper(Mapper mapper) {
 		this->mapper = mapper;
+		index.reset();
+	}
+
+	Sa1Banks Rom::getSa1Banks() const {
+		return sa1_banks;
+	}
+
+	void Rom::setSa1Banks(Sa1Banks sa1_banks) {
+		this->sa1_banks = sa1_banks;
+		index.reset();
 	}
 
 	void Rom::deriveMapper() {
@@ -42,14 +279,13 @@ namespace binary_file {
 
 		Mapper best_map{ Mapper::LO_ROM };
 
-		std::array<Mapper, 4> maps{
-			Mapper::LO_ROM,
-			Mapper::HI_ROM,
-			Mapper::EX_LO_ROM,
-			Mapper::EX_HI_ROM
-		};
+		for (auto map : header_mappers) {
+			// a rom too small to hold a header where this mapper expects it can't be using it
+			const auto header_end{ Address::SNES(0x00FFFF, map) };
+			if (!header_end.hasPc() || header_end.pc() >= getSize()) {
+				continue;
+			}
 
-		for (auto map : maps) {
 			int score{ 0 };
 			int high_bits{ 0 };
 			bool found_null{ false };
@@ -104,8 +340,8 @@ namespace binary_file {
 
 		mapper = best_map;
 
-		const auto mapper_byte{ read1(Address::SNES(0x00FFD5, mapper.value())) };
-		const auto rom_type_byte{ read1(Address::SNES(0x00FFD6, mapper.value())) };
+		const auto mapper_byte{ read1(Address::SNES(0x00FFD5, mapper.value(), sa1_banks)) };
+		const auto rom_type_byte{ read1(Address::SNES(0x00FFD6, mapper.value(), sa1_banks)) };
 		if (mapper == Mapper::LO_ROM) {
 			if (mapper_byte == 0x23 && (rom_type_byte == 0x32 || rom_type_byte == 0x34 || rom_type_byte == 0x35)) {
 				mapper = Mapper::SA1_ROM;
@@ -113,7 +349,7 @@ namespace binary_file {
 		}
 	}
 
-	byte Rom::read1(Address&& address) const {
+	byte Rom::read1(Address address) const {
 		try {
 			return BinaryFile::read1(address.pc());
 		} catch (const BinaryFileException&) {
@@ -125,40 +361,40 @@ namespace binary_file {
 	}
 
 	// these reads might be slow, but they should make sure bank crossing is handled right
-	_2bytes Rom::read2(Address&& address) const {
+	_2bytes Rom::read2(Address address) const {
 		auto second{ address + 1 };
 
 		return BinaryFile::join({
-			read1(std::forward<Address>(address)),
-			read1(std::move(second))
+			read1(address),
+			read1(second)
 		});
 	}
 
-	_4bytes Rom::read3(Address&& address) const {
+	_4bytes Rom::read3(Address address) const {
 		auto second{ address + 1 };
 		auto third{ address + 2 };
 
 		return BinaryFile::join({
-			read1(std::forward<Address>(address)),
-			read1(std::move(second)),
-			read1(std::move(third))
+			read1(address),
+			read1(second),
+			read1(third)
 		});
 	}
 
-	_4bytes Rom::read4(Address&& address) const {
+	_4bytes Rom::read4(Address address) const {
 		auto second{ address + 1 };
 		auto third{ address + 2 };
 		auto fourth{ address + 3 };
 
 		return BinaryFile::join({
-			read1(std::forward<Address>(address)),
-			read1(std::move(second)),
-			read1(std::move(third)),
-			read1(std::move(fourth))
+			read1(address),
+			read1(second),
+			read1(third),
+			read1(fourth)
 		});
 	}
 
-	void Rom::write1(Address&& address, byte byte_to_write) {
+	void Rom::write1(Address address, byte byte_to_write) {
 		try {
 			return BinaryFile::write1(address.pc(), byte_to_write);
 		}
@@ -170,36 +406,294 @@ namespace binary_file {
 		}
 	}
 
-	void Rom::write2(Address&& address, _2bytes bytes_to_write) {
+	void Rom::write2(Address address, _2bytes bytes_to_write) {
 		const auto split{ BinaryFile::split(bytes_to_write, 2) };
 
 		auto second{ address + 1 };
 
-		write1(std::forward<Address>(address), split[0]);
-		write1(std::move(second), split[1]);
+		write1(address, split[0]);
+		write1(second, split[1]);
 	}
 
-	void Rom::write3(Address&& address, _4bytes bytes_to_write) {
+	void Rom::write3(Address address, _4bytes bytes_to_write) {
 		const auto split{ BinaryFile::split(bytes_to_write, 3) };
 
 		auto second{ address + 1 };
 		auto third{ address + 2 };
 
-		write1(std::forward<Address>(address), split[0]);
-		write1(std::move(second), split[1]);
-		write1(std::move(third), split[2]);
+		write1(address, split[0]);
+		write1(second, split[1]);
+		write1(third, split[2]);
 	}
 
-	void Rom::write4(Address&& address, _4bytes bytes_to_write) {
+	void Rom::write4(Address address, _4bytes bytes_to_write) {
 		const auto split{ BinaryFile::split(bytes_to_write, 4) };
 
 		auto second{ address + 1 };
 		auto third{ address + 2 };
 		auto fourth{ address + 3 };
 
-		write1(std::forward<Address>(address), split[0]);
-		write1(std::move(second), split[1]);
-		write1(std::move(third), split[2]);
-		write1(std::move(fourth), split[3]);
+		write1(address, split[0]);
+		write1(second, split[1]);
+		write1(third, split[2]);
+		write1(fourth, split[3]);
+	}
+
+	std::vector<byte> Rom::readRange(Address address, size_t byte_count) const {
+		std::vector<byte> read_bytes{};
+		read_bytes.reserve(byte_count);
+
+		const auto view{ getView() };
+
+		for (const auto& [offset, length] : runsOf(address, byte_count)) {
+			read_bytes.insert(read_bytes.end(), view.begin() + offset, view.begin() + offset + length);
+		}
+
+		return read_bytes;
+	}
+
+	void Rom::writeRange(Address address, std::span<const byte> bytes_to_write) {
+		size_t written{ 0 };
+
+		for (const auto& [offset, length] : runsOf(address, bytes_to_write.size())) {
+			BinaryFile::write(offset, bytes_to_write.subspan(written, length));
+			written += length;
+		}
+	}
+
+	// every mapper maps whole 32 KiB SNES pages to contiguous PC ranges
+	std::vector<std::pair<size_t, size_t>> Rom::runsOf(Address address, size_t byte_count) const {
+		std::vector<std::pair<size_t, size_t>> runs{};
+
+		auto current{ address };
+		const auto first_byte_count{ byte_count };
+
+		while (byte_count != 0) {
+			const auto run{ std::min(byte_count, page_size - (current.snes() & (page_size - 1))) };
+
+			if (!current.hasPc() || current.pc() + run > getSize()) {
+				throw BinaryFileException(fmt::format(
+					"Invalid access of 0x{:X} byte(s) at {}",
+					first_byte_count, address.string()
+				));
+			}
+
+			runs.emplace_back(current.pc(), run);
+
+			byte_count -= run;
+			if (byte_count != 0) {
+				current += run;
+			}
+		}
+
+		return runs;
+	}
+
+	void Rom::expand(size_t new_size, byte fill) {
+		ensureMapper();
+
+		if (new_size < getSize()) {
+			throw BinaryFileException(fmt::format(
+				"Cannot expand ROM of 0x{:X} bytes to the smaller size of 0x{:X} bytes",
+				getSize(), new_size
+			));
+		}
+
+		if (new_size > maxRomSize(mapper.value())) {
+			throw BinaryFileException(fmt::format(
+				"Cannot expand ROM to 0x{:X} bytes, its mapper can only address 0x{:X} bytes",
+				new_size, maxRomSize(mapper.value())
+			));
+		}
+
+		ownedBytes().resize(new_size, fill);
+		index.reset();
+
+		updateHeader();
+	}
+
+	void Rom::convertMapper(Mapper new_mapper, byte fill) {
+		ensureMapper();
+
+		const auto old_mapper{ mapper.value() };
+
+		if (old_mapper == new_mapper) {
+			return;
+		}
+
+		if (old_mapper == Mapper::NO_ROM || new_mapper == Mapper::NO_ROM) {
+			throw MapperConversionException("Cannot convert a ROM from or to NO_ROM mapping");
+		}
+
+		const auto view{ getView() };
+
+		if (view.size() > maxRomSize(new_mapper)) {
+			throw MapperConversionException(fmt::format(
+				"Cannot convert a ROM of 0x{:X} bytes to a mapper that can only address 0x{:X} bytes",
+				view.size(), maxRomSize(new_mapper)
+			));
+		}
+
+		std::vector<PageMove> moves{};
+		size_t required_size{ 0 };
+		std::vector<bool> filled_pages(maxRomSize(Mapper::NO_ROM) / page_size);
+
+		for (size_t page{ 0 }; page < view.size(); page += page_size) {
+			const auto length{ std::min(page_size, view.size() - page) };
+			const auto source{ Address::PC(page, old_mapper, sa1_banks) };
+
+			if (!source.hasSnes()) {
+				throw MapperConversionException(fmt::format(
+					"{} is not mapped under the ROM's current mapper",
+					source.string()
+				));
+			}
+
+			// prefer the $00-$7F/$80-$FF mirror that keeps the page in place, e.g. LoROM's $00:8000 over $80:8000 for SA-1
+			auto snes_address{ source.snes() };
+			const auto old_mirror{ Address::SNES(snes_address ^ 0x800000, old_mapper, sa1_banks) };
+			const auto new_mirror{ Address::SNES(snes_address ^ 0x800000, new_mapper, sa1_banks) };
+
+			if (old_mirror.hasPc() && old_mirror.pc() == page && new_mirror.hasPc() && new_mirror.pc() == page) {
+				snes_address = new_mirror.snes();
+			}
+
+			const auto destination{ Address::SNES(snes_address, new_mapper, sa1_banks) };
+			const auto last{ Address::SNES(snes_address + length - 1, new_mapper, sa1_banks) };
+
+			if (!destination.hasPc() || !last.hasPc() || last.pc() != destination.pc() + length - 1) {
+				throw MapperConversionException(fmt::format(
+					"{} cannot be mapped to a contiguous PC range under the new mapper",
+					destination.string()
+				));
+			}
+
+			// pages keep their SNES address, so the first page landing on rom an earlier one already fills
+			// marks how much of the rom the new mapper shows at the addresses the old one uses
+			if (filled_pages[destination.pc() / page_size]) {
+				throw MapperConversionException(fmt::format(
+					"Cannot convert a ROM of 0x{:X} bytes, only its first 0x{:X} bytes sit at addresses the "
+					"new mapper maps to separate rom",
+					view.size(), page
+				));
+			}
+
+			filled_pages[destination.pc() / page_size] = true;
+
+			moves.push_back({ page, destination.pc(), length });
+			required_size = std::max(required_size, destination.pc() + length);
+		}
+
+		// bank $00 holds the boot code and vectors, keep it in place if the new mapper stops mirroring it
+		const auto old_boot_page{ Address::SNES(boot_page_snes_address, old_mapper, sa1_banks) };
+		const auto new_boot_page{ Address::SNES(boot_page_snes_address, new_mapper, sa1_banks) };
+
+		if (old_boot_page.hasPc() && new_boot_page.hasPc() && old_boot_page.pc() + page_size <= view.size() &&
+			std::none_of(moves.begin(), moves.end(), [&](const auto& move) { return move.destination == new_boot_page.pc(); })) {
+			moves.push_back({ old_boot_page.pc(), new_boot_page.pc(), page_size });
+			required_size = std::max(required_size, new_boot_page.pc() + page_size);
+		}
+
+		std::sort(moves.begin(), moves.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.destination < rhs.destination;
+		});
+
+		for (size_t i{ 1 }; i < moves.size(); ++i) {
+			if (moves[i - 1].destination + moves[i - 1].length > moves[i].destination) {
+				throw MapperConversionException(fmt::format(
+					"PC 0x{:06X} and 0x{:06X} would both be moved to 0x{:06X} under the new mapper",
+					moves[i - 1].source, moves[i].source, moves[i].destination
+				));
+			}
+		}
+
+		auto new_size{ view.size() };
+
+		if (required_size > new_size) {
+			const auto standard_size{ std::lower_bound(standard_rom_sizes.begin(), standard_rom_sizes.end(), required_size) };
+			new_size = standard_size == standard_rom_sizes.end() ? required_size : *standard_size;
+		}
+
+		if (new_size > maxRomSize(new_mapper)) {
+			throw MapperConversionException(fmt::format(
+				"Converted ROM would need 0x{:X} bytes, but the new mapper can only address 0x{:X} bytes",
+				new_size, maxRomSize(new_mapper)
+			));
+		}
+
+		auto converted{ makeStorage() };
+		converted.resize(new_size, fill);
+
+		for (const auto& move : moves) {
+			std::copy_n(view.begin() + move.source, move.length, converted.begin() + move.destination);
+		}
+
+		// the page holding the old header can land where another mapper expects its header, e.g. it stays
+		// put for LoROM to ExLoROM, deriveMapper would find that copy scoring the same as the real one and
+		// could pick the other mapper, so clear every copy of the header that isn't the new mapper's
+		const auto new_header{ Address::SNES(header_snes_address, new_mapper, sa1_banks) };
+
+		if (new_header.hasPc() && new_header.pc() + header_size <= new_size) {
+			for (const auto map : header_mappers) {
+				const auto header{ Address::SNES(header_snes_address, map) };
+
+				if (header.hasPc() && header.pc() != new_header.pc() && header.pc() + header_size <= new_size &&
+					std::equal(converted.begin() + header.pc(), converted.begin() + header.pc() + header_size,
+						converted.begin() + new_header.pc())) {
+					std::fill_n(converted.begin() + header.pc(), header_size, fill);
+				}
+			}
+		}
+
+		replaceBytes(std::move(converted));
+		mapper = new_mapper;
+		index.reset();
+
+		updateHeader();
+	}
+
+	void Rom::updateHeader() {
+		if (mapper == Mapper::NO_ROM) {
+			return;
+		}
+
+		const auto header{ Address::SNES(header_snes_address, mapper.value(), sa1_banks) };
+
+		if (!header.hasPc() || header.pc() + header_size > getSize()) {
+			return;
+		}
+
+		auto& owned{ ownedBytes() };
+		const auto at{ [&](size_t offset) -> byte& { return owned[header.pc() + offset]; } };
+
+		// keep the FastROM bit, everything else about the map mode follows from the mapper
+		at(map_mode_offset) = (at(map_mode_offset) & 0x10) | 0x20 | mapModeOf(mapper.value());
+		at(rom_size_offset) = romSizeByteOf(owned.size());
+
+		// deriveMapper only tells SA-1 from LoROM by a $23 map mode, SA-1 carts never set the FastROM bit,
+		// and an SA-1 chip byte, keep a battery if the old chip byte had one
+		if (mapper == Mapper::SA1_ROM || mapper == Mapper::BIG_SA1_ROM) {
+			const auto chip{ at(chip_offset) };
+
+			at(map_mode_offset) = 0x20 | mapModeOf(mapper.value());
+
+			if (chip != 0x32 && chip != 0x34 && chip != 0x35) {
+				const auto battery{ (chip & 0x0F) == 0x02 || (chip & 0x0F) == 0x05 || (chip & 0x0F) == 0x06 };
+				at(chip_offset) = battery ? 0x35 : 0x34;
+			}
+		}
+
+		// the checksum covers itself, so sum with the pair every valid header holds, 0xFFFF and 0x0000
+		at(checksum_complement_offset) = 0xFF;
+		at(checksum_complement_offset + 1) = 0xFF;
+		at(checksum_offset) = 0x00;
+		at(checksum_offset + 1) = 0x00;
+
+		const auto checksum{ checksumOf(owned) };
+
+		at(checksum_complement_offset) = static_cast<byte>(~checksum);
+		at(checksum_complement_offset + 1) = static_cast<byte>(~checksum >> 8);
+		at(checksum_offset) = static_cast<byte>(checksum);
+		at(checksum_offset + 1) = static_cast<byte>(checksum >> 8);
 	}
 }
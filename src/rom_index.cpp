@@ -0,0 +1,346 @@
+#include "../include/rom_index.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "../include/address.h"
+#include "../include/hash.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr uint64_t index_magic{ 0x0000'1A58'4449'4642 }; // "BFIDX\x1A"
+		constexpr size_t fingerprint_edge{ 0x1000 };
+		constexpr size_t fingerprint_stride{ 0x10000 };
+		constexpr size_t fingerprint_sample{ 0x40 };
+		constexpr size_t header_snes_address{ 0x00FFC0 };
+		// magic, version, mapping, SA-1 banks, size, mtime, fingerprint, header bytes and both counts
+		constexpr size_t fixed_fields_size{ 8 + 4 + 4 + 4 + 8 + 8 + 8 + RomHeader::size + 4 + 4 };
+		constexpr size_t trailer_size{ 8 };
+
+		class Writer {
+		public:
+			std::vector<byte> bytes{};
+
+			void put(uint64_t value, size_t byte_count) {
+				for (size_t i{ 0 }; i != byte_count; ++i) {
+					bytes.push_back((value >> (i * 8)) & 0xFF);
+				}
+			}
+		};
+
+		class Reader {
+		public:
+			Reader(std::span<const byte> bytes) : bytes(bytes) {}
+
+			// 0 past the end, callers check isValid once at the end
+			uint64_t get(size_t byte_count) {
+				if (position + byte_count > bytes.size()) {
+					position = bytes.size() + 1;
+					return 0;
+				}
+
+				uint64_t value{ 0 };
+				for (size_t i{ 0 }; i != byte_count; ++i) {
+					value |= static_cast<uint64_t>(bytes[position++]) << (i * 8);
+				}
+
+				return value;
+			}
+
+			bool isValid() const {
+				return position <= bytes.size();
+			}
+
+			size_t getRemaining() const {
+				return isValid() ? bytes.size() - position : 0;
+			}
+
+		private:
+			std::span<const byte> bytes;
+			size_t position{ 0 };
+		};
+
+		// every run of one fill byte in [begin, end), the first and last run are kept whatever their
+		// length so runs crossing a slice boundary can be joined afterwards
+		std::vector<FreeRange> scanRuns(std::span<const byte> bytes, size_t begin, size_t end) {
+			std::vector<FreeRange> runs{};
+
+			auto offset{ begin };
+			while (offset != end) {
+				const auto fill{ bytes[offset] };
+				const auto run_end{ static_cast<size_t>(std::find_if(bytes.begin() + offset, bytes.begin() + end,
+					[fill](byte value) { return value != fill; }) - bytes.begin()) };
+
+				if ((fill == 0x00 || fill == 0xFF) &&
+					(run_end - offset >= FreeRange::min_length || offset == begin || run_end == end)) {
+					runs.push_back({ offset, run_end - offset, fill });
+				}
+
+				offset = run_end;
+			}
+
+			return runs;
+		}
+
+		// free ranges are at least min_length long and don't overlap, so anything larger than an
+		// index of a rom this size with as many of them as fit is garbage
+		uintmax_t maxIndexSize(size_t rom_size) {
+			return fixed_fields_size + (rom_size + RomIndex::chunk_size - 1) / RomIndex::chunk_size * 8 +
+				rom_size / FreeRange::min_length * 9 + trailer_size;
+		}
+
+		// unique per process and call, so two processes saving the same index don't write into one
+		// temporary file
+		fs::path temporaryPathOf(const fs::path& index_path) {
+#ifdef _WIN32
+			const auto process_id{ _getpid() };
+#else
+			const auto process_id{ getpid() };
+#endif
+			std::random_device random{};
+
+			auto temporary_path{ index_path };
+			temporary_path += fmt::format(".{}-{:08x}.tmp", process_id, random());
+			return temporary_path;
+		}
+	}
+
+	RomHeader RomHeader::fromBytes(std::span<const byte, size> bytes) {
+		RomHeader header{};
+
+		header.title.assign(bytes.begin(), bytes.begin() + 21);
+		header.map_mode = bytes[0x15];
+		header.rom_type = bytes[0x16];
+		header.rom_size = bytes[0x17];
+		header.sram_size = bytes[0x18];
+		header.region = bytes[0x19];
+		header.developer = bytes[0x1A];
+		header.version = bytes[0x1B];
+		header.checksum_complement = bytes[0x1C] | bytes[0x1D] << 8;
+		header.checksum = bytes[0x1E] | bytes[0x1F] << 8;
+
+		return header;
+	}
+
+	RomIndex RomIndex::build(std::span<const byte> bytes, std::optional<Mapper> mapper, Sa1Banks sa1_banks) {
+		RomIndex index{ mapper, sa1_banks, {}, bytes.size(), fingerprintOf(bytes), {}, {} };
+
+		if (mapper.has_value()) {
+			const auto header{ Address::SNES(header_snes_address, mapper.value(), sa1_banks) };
+
+			if (header.hasPc() && header.pc() + RomHeader::size <= bytes.size()) {
+				std::copy_n(bytes.begin() + header.pc(), RomHeader::size, index.header_bytes.begin());
+			}
+		}
+
+		const auto chunk_count{ (bytes.size() + chunk_size - 1) / chunk_size };
+
+		index.chunk_hashes.resize(chunk_count);
+		std::vector<std::vector<FreeRange>> partial(workerCount(chunk_count, 1));
+
+		parallelFor(chunk_count, 1, [&](size_t task, size_t begin, size_t end) {
+			for (auto chunk{ begin }; chunk != end; ++chunk) {
+				index.chunk_hashes[chunk] = hash64(bytes.subspan(chunk * chunk_size, std::min(chunk_size, bytes.size() - chunk * chunk_size)));
+			}
+
+			partial[task] = scanRuns(bytes, begin * chunk_size, std::min(end * chunk_size, bytes.size()));
+		});
+
+		std::vector<FreeRange> runs{};
+
+		for (const auto& task_runs : partial) {
+			for (const auto& run : task_runs) {
+				if (!runs.empty() && runs.back().fill == run.fill && runs.back().offset + runs.back().length == run.offset) {
+					runs.back().length += run.length;
+				}
+				else {
+					runs.push_back(run);
+				}
+			}
+		}
+
+		std::copy_if(runs.begin(), runs.end(), std::back_inserter(index.free_ranges), [](const auto& run) {
+			return run.length >= FreeRange::min_length;
+		});
+
+		return index;
+	}
+
+	uint64_t RomIndex::fingerprintOf(std::span<const byte> bytes) {
+		auto fingerprint{ hash64(bytes.first(std::min(bytes.size(), fingerprint_edge)), bytes.size()) };
+		fingerprint = hash64(bytes.last(std::min(bytes.size(), fingerprint_edge)), fingerprint);
+
+		for (size_t offset{ fingerprint_stride }; offset + fingerprint_sample <= bytes.size(); offset += fingerprint_stride) {
+			fingerprint = hash64(bytes.subspan(offset - fingerprint_sample, fingerprint_sample), fingerprint);
+		}
+
+		return fingerprint;
+	}
+
+	fs::path RomIndex::pathOf(const fs::path& rom_path) {
+		auto index_path{ rom_path };
+		index_path += ".bfidx";
+		return index_path;
+	}
+
+	std::optional<RomIndex> RomIndex::load(const fs::path& rom_path, std::span<const byte> bytes) {
+		std::error_code error{};
+		const auto mtime{ fs::last_write_time(rom_path, error) };
+		const auto index_path{ pathOf(rom_path) };
+
+		if (error || !fs::is_regular_file(index_path, error)) {
+			return std::nullopt;
+		}
+
+		const auto index_size{ fs::file_size(index_path, error) };
+
+		if (error || index_size < fixed_fields_size + trailer_size || index_size > maxIndexSize(bytes.size())) {
+			return std::nullopt;
+		}
+
+		std::ifstream file(index_path, std::ios::binary);
+		std::vector<byte> contents(index_size);
+
+		if (!file || !file.read(reinterpret_cast<char*>(contents.data()), contents.size())) {
+			return std::nullopt;
+		}
+
+		const auto payload{ std::span<const byte>(contents).first(contents.size() - trailer_size) };
+		Reader trailer{ std::span<const byte>(contents).last(trailer_size) };
+
+		if (trailer.get(trailer_size) != hash64(payload)) {
+			return std::nullopt;
+		}
+
+		Reader reader{ payload };
+
+		if (reader.get(8) != index_magic || reader.get(4) != version) {
+			return std::nullopt;
+		}
+
+		const auto mapping{ static_cast<uint32_t>(reader.get(4)) };
+		const auto packed_banks{ static_cast<uint16_t>(reader.get(4)) };
+		const auto size{ reader.get(8) };
+		const auto stored_mtime{ static_cast<int64_t>(reader.get(8)) };
+		const auto fingerprint{ reader.get(8) };
+
+		if (size != bytes.size() || stored_mtime != static_cast<int64_t>(mtime.time_since_epoch().count()) ||
+			fingerprint != fingerprintOf(bytes) || mapping > static_cast<uint32_t>(Mapper::NO_ROM) + 1) {
+			return std::nullopt;
+		}
+
+		RomIndex index{
+			mapping == 0 ? std::nullopt : std::optional<Mapper>(static_cast<Mapper>(mapping - 1)),
+			Sa1Banks::fromPacked(packed_banks),
+			{},
+			bytes.size(),
+			fingerprint,
+			{},
+			{}
+		};
+
+		for (auto& header_byte : index.header_bytes) {
+			header_byte = static_cast<byte>(reader.get(1));
+		}
+
+		const auto chunk_count{ reader.get(4) };
+		const auto free_count{ reader.get(4) };
+
+		if (chunk_count != (bytes.size() + chunk_size - 1) / chunk_size || reader.getRemaining() != chunk_count * 8 + free_count * 9) {
+			return std::nullopt;
+		}
+
+		index.chunk_hashes.resize(chunk_count);
+		for (auto& chunk_hash : index.chunk_hashes) {
+			chunk_hash = reader.get(8);
+		}
+
+		index.free_ranges.resize(free_count);
+		for (auto& range : index.free_ranges) {
+			range.offset = reader.get(4);
+			range.length = reader.get(4);
+			range.fill = static_cast<byte>(reader.get(1));
+		}
+
+		if (!reader.isValid()) {
+			return std::nullopt;
+		}
+
+		return index;
+	}
+
+	void RomIndex::save(const fs::path& rom_path, fs::file_time_type mtime) const {
+		Writer writer{};
+
+		writer.put(index_magic, 8);
+		writer.put(version, 4);
+		writer.put(mapper.has_value() ? static_cast<uint32_t>(mapper.value()) + 1 : 0, 4);
+		writer.put(sa1_banks.getPacked(), 4);
+		writer.put(size, 8);
+		writer.put(static_cast<uint64_t>(mtime.time_since_epoch().count()), 8);
+		writer.put(fingerprint, 8);
+
+		for (const auto header_byte : header_bytes) {
+			writer.put(header_byte, 1);
+		}
+
+		writer.put(chunk_hashes.size(), 4);
+		writer.put(free_ranges.size(), 4);
+
+		for (const auto chunk_hash : chunk_hashes) {
+			writer.put(chunk_hash, 8);
+		}
+
+		for (const auto& range : free_ranges) {
+			writer.put(range.offset, 4);
+			writer.put(range.length, 4);
+			writer.put(range.fill, 1);
+		}
+
+		writer.put(hash64(writer.bytes), trailer_size);
+
+		const auto index_path{ pathOf(rom_path) };
+		const auto temporary_path{ temporaryPathOf(index_path) };
+
+		{
+			std::ofstream file(temporary_path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(writer.bytes.data()), writer.bytes.size());
+
+			if (!file) {
+				file.close();
+
+				// the name is never reused, so nothing else would clean it up
+				std::error_code error{};
+				fs::remove(temporary_path, error);
+
+				throw BinaryFileException(fmt::format(
+					"Failed to write ROM index {}",
+					temporary_path.string()
+				));
+			}
+		}
+
+		std::error_code error{};
+		fs::rename(temporary_path, index_path, error);
+
+		if (error) {
+			fs::remove(temporary_path, error);
+			throw BinaryFileException(fmt::format(
+				"Failed to replace ROM index {}",
+				index_path.string()
+			));
+		}
+	}
+
+	RomHeader RomIndex::getHeader() const {
+		return RomHeader::fromBytes(header_bytes);
+	}
+}
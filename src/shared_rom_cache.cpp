@@ -0,0 +1,336 @@
+#include "shared_rom_cache.h"
+
+#include <atomic>
+#include <cstring>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace binary_file {
+	namespace {
+		constexpr uint64_t segment_magic{ 0x4D4F525346425342 }; // "BSBFSROM"
+		constexpr uint32_t segment_version{ 2 };
+		constexpr size_t data_offset{ 0x1000 };
+
+		enum SegmentState : uint32_t {
+			BUILDING = 0,
+			READY = 1
+		};
+
+		// ftruncate zero fills the segment, so a fresh one reads as BUILDING until its publisher is done
+		struct SegmentHeader {
+			uint64_t magic;
+			uint32_t version;
+			uint32_t state;
+			FileIdentity identity;
+			uint32_t mapping; // 0 for no mapper, otherwise the mapper + 1
+			uint32_t sa1_banks;
+			uint32_t path_size; // the canonical path of the file follows the header, 0 if it didn't fit
+		};
+
+		constexpr size_t max_path_size{ data_offset - sizeof(SegmentHeader) };
+
+		static_assert(sizeof(SegmentHeader) <= data_offset);
+
+		uint32_t loadState(const SegmentHeader& header) {
+			return std::atomic_ref(const_cast<uint32_t&>(header.state)).load(std::memory_order_acquire);
+		}
+
+#ifndef _WIN32
+		std::string canonicalOf(const fs::path& path) {
+			std::error_code error{};
+			auto canonical{ fs::weakly_canonical(path, error) };
+
+			if (error) {
+				canonical = fs::absolute(path);
+			}
+
+			return canonical.string();
+		}
+
+		std::string segmentPrefix() {
+			return fmt::format("binary-file-{}-", geteuid());
+		}
+
+		// the key only has to be stable, two paths sharing a name just keep replacing each other's
+		// segment as the identity check fails, the user id keeps every user in their own namespace so
+		// nobody attaches to a segment another user got to publish first
+		std::string segmentName(const fs::path& path) {
+			uint64_t hash{ 14695981039346656037u };
+
+			for (const auto c : canonicalOf(path)) {
+				hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211u;
+			}
+
+			return fmt::format("/{}{:016x}", segmentPrefix(), hash);
+		}
+
+		// a segment outlives every process that used it so the next one can still attach, which also
+		// means nothing unlinks it once its file is deleted, renamed or rewritten and no process opens
+		// that path again, so before publishing sweep this user's segments whose file no longer
+		// matches, segments a publisher is still filling are locked and left alone
+		void sweepStaleSegments() {
+			std::error_code error{};
+			fs::directory_iterator entries{ "/dev/shm", error };
+
+			// not every system exposes shared memory as a directory, the sweep is only housekeeping
+			if (error) {
+				return;
+			}
+
+			const auto prefix{ segmentPrefix() };
+
+			for (const auto& entry : entries) {
+				const auto file_name{ entry.path().filename().string() };
+
+				if (!file_name.starts_with(prefix)) {
+					continue;
+				}
+
+				const auto name{ "/" + file_name };
+				const auto descriptor{ shm_open(name.c_str(), O_RDONLY, 0) };
+
+				if (descriptor == -1) {
+					continue;
+				}
+
+				struct stat status{};
+
+				if (fstat(descriptor, &status) != 0 || status.st_uid != geteuid() || (status.st_mode & 077) != 0) {
+					close(descriptor);
+					continue;
+				}
+
+				auto stale{ true };
+
+				if (static_cast<size_t>(status.st_size) >= data_offset) {
+					const auto mapped{ mmap(nullptr, data_offset, PROT_READ, MAP_SHARED, descriptor, 0) };
+
+					if (mapped == MAP_FAILED) {
+						close(descriptor);
+						continue;
+					}
+
+					const auto& header{ *static_cast<const SegmentHeader*>(mapped) };
+
+					// a segment without its path can't be checked, attaching still catches it if it's stale
+					if (loadState(header) == READY && header.magic == segment_magic && header.version == segment_version) {
+						if (header.path_size == 0 || header.path_size > max_path_size) {
+							stale = false;
+						}
+						else {
+							const std::string_view stored{ reinterpret_cast<const char*>(&header + 1), header.path_size };
+							const auto identity{ identityOf(stored) };
+
+							stale = !identity.has_value() || identity.value() != header.identity;
+						}
+					}
+
+					munmap(mapped, data_offset);
+				}
+
+				// the lock only fails while a publisher is still filling the segment
+				if (stale && flock(descriptor, LOCK_SH | LOCK_NB) == 0) {
+					shm_unlink(name.c_str());
+				}
+
+				close(descriptor);
+			}
+		}
+#endif
+	}
+
+#ifdef _WIN32
+	// named sections on windows don't outlive their last handle, so there is nothing to attach to
+	// once the publishing process has exited, every process just loads its own copy
+	std::optional<FileIdentity> identityOf(const fs::path& path) {
+		return std::nullopt;
+	}
+
+	std::optional<SharedRomSegment> attachSharedRom(const fs::path& path) {
+		return std::nullopt;
+	}
+
+	bool publishSharedRom(const fs::path& path, const FileIdentity& identity, std::span<const byte> bytes,
+		std::optional<Mapper> mapper, Sa1Banks sa1_banks) {
+		return false;
+	}
+
+	void unlinkSharedRom(const fs::path& path) {}
+#else
+	std::optional<FileIdentity> identityOf(const fs::path& path) {
+		struct stat status{};
+
+		if (stat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) {
+			return std::nullopt;
+		}
+
+		std::error_code error{};
+		const auto mtime{ fs::last_write_time(path, error) };
+
+		if (error) {
+			return std::nullopt;
+		}
+
+		return FileIdentity{
+			static_cast<uint64_t>(status.st_size),
+			static_cast<int64_t>(mtime.time_since_epoch().count()),
+			static_cast<uint64_t>(status.st_ino),
+			static_cast<uint64_t>(status.st_dev)
+		};
+	}
+
+	std::optional<SharedRomSegment> attachSharedRom(const fs::path& path) {
+		const auto name{ segmentName(path) };
+		const auto descriptor{ shm_open(name.c_str(), O_RDONLY, 0) };
+
+		if (descriptor == -1) {
+			return std::nullopt;
+		}
+
+		// a publisher holds an exclusive lock from before it resizes the segment until it is done, so
+		// getting one means the segment is either stale or was abandoned halfway, processes still
+		// attached keep their mapping and the memory goes once the last one unmaps it
+		const auto unlinkIfAbandoned{ [&] {
+			if (flock(descriptor, LOCK_SH | LOCK_NB) == 0) {
+				shm_unlink(name.c_str());
+			}
+
+			close(descriptor);
+		} };
+
+		struct stat status{};
+
+		// anyone can create a segment under a name they can guess, only trust one this user made and
+		// nobody else can write to
+		if (fstat(descriptor, &status) != 0 || status.st_uid != geteuid() || (status.st_mode & 077) != 0) {
+			close(descriptor);
+			return std::nullopt;
+		}
+
+		// too small to hold a header, either its publisher hasn't resized it yet or died before it did
+		if (static_cast<size_t>(status.st_size) < data_offset) {
+			unlinkIfAbandoned();
+			return std::nullopt;
+		}
+
+		const auto segment_size{ static_cast<size_t>(status.st_size) };
+		const auto mapped{ mmap(nullptr, segment_size, PROT_READ, MAP_SHARED, descriptor, 0) };
+
+		if (mapped == MAP_FAILED) {
+			close(descriptor);
+			return std::nullopt;
+		}
+
+		std::shared_ptr<const void> owner(mapped, [segment_size](const void* mapping) {
+			munmap(const_cast<void*>(mapping), segment_size);
+		});
+
+		const auto& header{ *static_cast<const SegmentHeader*>(mapped) };
+		const auto identity{ identityOf(path) };
+
+		if (loadState(header) != READY || header.magic != segment_magic || header.version != segment_version ||
+			!identity.has_value() || header.identity != identity.value() || segment_size != data_offset + header.identity.size ||
+			header.mapping > static_cast<uint32_t>(Mapper::NO_ROM) + 1) {
+			unlinkIfAbandoned();
+			return std::nullopt;
+		}
+
+		close(descriptor);
+
+		return SharedRomSegment{
+			owner,
+			{ static_cast<const byte*>(mapped) + data_offset, header.identity.size },
+			header.mapping == 0 ? std::nullopt : std::optional<Mapper>(static_cast<Mapper>(header.mapping - 1)),
+			Sa1Banks::fromPacked(static_cast<uint16_t>(header.sa1_banks))
+		};
+	}
+
+	bool publishSharedRom(const fs::path& path, const FileIdentity& identity, std::span<const byte> bytes,
+		std::optional<Mapper> mapper, Sa1Banks sa1_banks) {
+		if (bytes.empty() || bytes.size() != identity.size) {
+			return false;
+		}
+
+		sweepStaleSegments();
+
+		const auto name{ segmentName(path) };
+		const auto descriptor{ shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600) };
+
+		if (descriptor == -1) {
+			return false;
+		}
+
+		const auto segment_size{ data_offset + bytes.size() };
+
+		if (flock(descriptor, LOCK_EX) != 0) {
+			close(descriptor);
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		// an attacher can take the empty segment for an abandoned one and unlink it before the lock
+		// is taken, publishing into it then would only waste the memory
+		struct stat created{};
+		struct stat named{};
+		const auto check{ shm_open(name.c_str(), O_RDONLY, 0) };
+		const auto still_named{ check != -1 && fstat(descriptor, &created) == 0 && fstat(check, &named) == 0 &&
+			created.st_ino == named.st_ino && created.st_dev == named.st_dev };
+
+		if (check != -1) {
+			close(check);
+		}
+
+		if (!still_named) {
+			close(descriptor);
+			return false;
+		}
+
+		if (ftruncate(descriptor, static_cast<off_t>(segment_size)) != 0) {
+			close(descriptor);
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		const auto mapped{ mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) };
+
+		if (mapped == MAP_FAILED) {
+			close(descriptor);
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		auto& header{ *static_cast<SegmentHeader*>(mapped) };
+
+		header.magic = segment_magic;
+		header.version = segment_version;
+		header.identity = identity;
+		header.mapping = mapper.has_value() ? static_cast<uint32_t>(mapper.value()) + 1 : 0;
+		header.sa1_banks = sa1_banks.getPacked();
+
+		if (const auto canonical{ canonicalOf(path) }; canonical.size() <= max_path_size) {
+			header.path_size = static_cast<uint32_t>(canonical.size());
+			std::memcpy(&header + 1, canonical.data(), canonical.size());
+		}
+
+		std::memcpy(static_cast<byte*>(mapped) + data_offset, bytes.data(), bytes.size());
+
+		std::atomic_ref(header.state).store(READY, std::memory_order_release);
+
+		munmap(mapped, segment_size);
+		close(descriptor);
+
+		return true;
+	}
+
+	void unlinkSharedRom(const fs::path& path) {
+		shm_unlink(segmentName(path).c_str());
+	}
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef SHARED_ROM_CACHE_H
+#define SHARED_ROM_CACHE_H
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "../include/binary_file.h"
+#include "../include/mapper.h"
+
+namespace fs = std::filesystem;
+
+namespace binary_file {
+	// identifies one version of a file on disk, taken before its contents are read so a later
+	// modification always shows up as a mismatch
+	struct FileIdentity {
+		uint64_t size;
+		int64_t mtime;
+		uint64_t inode;
+		uint64_t device;
+
+		bool operator==(const FileIdentity& rhs) const = default;
+	};
+
+	struct SharedRomSegment {
+		std::shared_ptr<const void> owner;
+		std::span<const byte> bytes;
+		std::optional<Mapper> mapper;
+		Sa1Banks sa1_banks;
+	};
+
+	std::optional<FileIdentity> identityOf(const fs::path& path);
+
+	// maps the published copy of path read-only, nullopt if there is none, it is still being published
+	// or it is stale, stale segments are unlinked so the next publish can replace them
+	std::optional<SharedRomSegment> attachSharedRom(const fs::path& path);
+
+	// false if another process got there first or shared memory isn't available
+	bool publishSharedRom(const fs::path& path, const FileIdentity& identity, std::span<const byte> bytes,
+		std::optional<Mapper> mapper, Sa1Banks sa1_banks);
+
+	void unlinkSharedRom(const fs::path& path);
+}
+
+#endif // SHARED_ROM_CACHE_H
@@ -0,0 +1,17 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// picks the widest vector extension the compiler was told it may use, everything keeps a scalar fallback
+#if defined(__AVX2__)
+#define BINARY_FILE_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BINARY_FILE_SSE2 1
+#endif
+
+#if defined(BINARY_FILE_AVX2) || defined(BINARY_FILE_SSE2)
+#include <immintrin.h>
+#endif
+
+#endif // SIMD_H
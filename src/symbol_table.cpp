@@ -0,0 +1,428 @@
+#include "../include/symbol_table.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#include "../include/libstr.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t min_bytes_per_task{ 1 << 18 };
+		constexpr size_t expected_line_length{ 24 };
+		constexpr size_t prefetch_distance{ 16 };
+		constexpr size_t radix_bits{ 12 };
+		constexpr size_t radix_size{ 1 << radix_bits };
+		constexpr size_t radix_mask{ radix_size - 1 };
+
+		template<typename Word>
+		Word load(const char* bytes) {
+			Word word{};
+			std::memcpy(&word, bytes, sizeof(word));
+			return word;
+		}
+
+		// a word at a time, with the tail read as one last word overlapping the ones before it so no
+		// label takes a byte loop, labels are short and a byte-wise hash spends most of its time on
+		// the multiply chain
+		uint32_t hashLabel(std::string_view label) {
+			const auto data{ label.data() };
+			const auto size{ label.size() };
+
+			uint64_t hash{ 0x9E3779B97F4A7C15u ^ size };
+
+			const auto mix{ [&hash](uint64_t word) {
+				hash = (hash ^ word) * 0xFF51AFD7ED558CCDu;
+				hash ^= hash >> 32;
+			} };
+
+			if (size >= sizeof(uint64_t)) {
+				for (size_t position{ 0 }; position + sizeof(uint64_t) < size; position += sizeof(uint64_t)) {
+					mix(load<uint64_t>(data + position));
+				}
+
+				mix(load<uint64_t>(data + size - sizeof(uint64_t)));
+			}
+			else if (size >= sizeof(uint32_t)) {
+				mix(load<uint32_t>(data) | static_cast<uint64_t>(load<uint32_t>(data + size - sizeof(uint32_t))) << 32);
+			}
+			else if (size != 0) {
+				mix(static_cast<unsigned char>(data[0]) | static_cast<unsigned char>(data[size / 2]) << 8 |
+					static_cast<unsigned char>(data[size - 1]) << 16);
+			}
+
+			return static_cast<uint32_t>(hash);
+		}
+
+		uint32_t hexValue(unsigned char c) {
+			return is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+		}
+
+		const char* parseHex(const char* position, const char* end, uint32_t& value) {
+			const auto start{ position };
+
+			value = 0;
+			while (position != end && is_xdigit(*position) && position - start != 8) {
+				value = (value << 4) | hexValue(*position++);
+			}
+
+			return position;
+		}
+
+		// spaces short of the newline ending the line
+		const char* skipBlank(const char* position, const char* end) {
+			while (position != end && *position != '\n' && is_space(*position)) {
+				++position;
+			}
+
+			return position;
+		}
+
+		const char* parseName(const char* position, const char* end, std::string_view& name) {
+			const auto name_start{ skipBlank(position, end) };
+			const auto name_end{ find_space(name_start, end) };
+
+			name = { name_start, static_cast<size_t>(name_end - name_start) };
+			return name_end;
+		}
+
+		// parses the line starting at position, leaving name empty if it holds no symbol, every scan
+		// stops at its newline and the return value is where parsing stopped, so the caller only has
+		// to look for the next line if it wasn't there already
+		const char* parseLine(const char* position, const char* end, std::string_view& name, uint32_t& snes_address) {
+			name = {};
+
+			// asar writes every label as "bb:aaaa name", which is checked and decoded in one go instead
+			// of digit by digit, and-ing the char_props of all six digits tests them with one branch
+			if (end - position >= 8 && position[2] == ':' && position[7] != '\n' && is_space(position[7])) {
+				const auto props{ [position](size_t index) {
+					return char_props[static_cast<unsigned char>(position[index])];
+				} };
+				const auto digit{ [position](size_t index) {
+					return hexValue(static_cast<unsigned char>(position[index]));
+				} };
+
+				if (props(0) & props(1) & props(3) & props(4) & props(5) & props(6) & 0x01) {
+					snes_address = digit(0) << 20 | digit(1) << 16 | digit(3) << 12 | digit(4) << 8 | digit(5) << 4 | digit(6);
+					return parseName(position + 7, end, name);
+				}
+			}
+
+			position = skipBlank(position, end);
+
+			const auto address_end{ parseHex(position, end, snes_address) };
+
+			if (address_end == position) {
+				return position;
+			}
+
+			position = address_end;
+
+			if (position != end && *position == ':') {
+				uint32_t bank_offset{ 0 };
+				const auto offset_end{ parseHex(position + 1, end, bank_offset) };
+
+				if (snes_address > 0xFF || offset_end == position + 1 || bank_offset > 0xFFFF) {
+					return offset_end;
+				}
+
+				snes_address = (snes_address << 16) | bank_offset;
+				position = offset_end;
+			}
+
+			if (snes_address > 0xFFFFFF || position == end || *position == '\n' || !is_space(*position)) {
+				return position;
+			}
+
+			return parseName(position, end, name);
+		}
+
+		// the [labels] sections of a sectioned (WLA) file, or the whole file if it has no sections
+		std::vector<std::pair<size_t, size_t>> labelRanges(std::string_view text) {
+			std::vector<size_t> headers{};
+
+			if (!text.empty() && text.front() == '[') {
+				headers.push_back(0);
+			}
+
+			for (auto position{ text.find("\n[") }; position != std::string_view::npos; position = text.find("\n[", position + 1)) {
+				headers.push_back(position + 1);
+			}
+
+			if (headers.empty()) {
+				return { { 0, text.size() } };
+			}
+
+			std::vector<std::pair<size_t, size_t>> ranges{};
+
+			for (size_t i{ 0 }; i != headers.size(); ++i) {
+				const auto header_end{ std::min(text.find('\n', headers[i]), text.size()) };
+				const auto content_end{ i + 1 != headers.size() ? headers[i + 1] : text.size() };
+
+				auto header{ text.substr(headers[i], header_end - headers[i]) };
+				while (!header.empty() && is_space(header.back())) {
+					header.remove_suffix(1);
+				}
+
+				if (header == "[labels]" && header_end < content_end) {
+					ranges.emplace_back(header_end + 1, content_end);
+				}
+			}
+
+			return ranges;
+		}
+	}
+
+	SymbolTable::SymbolTable(const fs::path& path) {
+		if (!fs::is_regular_file(path)) {
+			throw SymbolFileException(fmt::format(
+				"Symbol file {} does not exist or is not a regular file",
+				path.string()
+			));
+		}
+
+		const MappedFile file{ path };
+		const auto text{ file.getText() };
+
+		if (text.size() > std::numeric_limits<uint32_t>::max()) {
+			throw SymbolFileException(fmt::format(
+				"Symbol file {} is larger than 4 GiB",
+				path.string()
+			));
+		}
+
+		std::vector<Chunk> chunks{};
+
+		for (const auto& [range_begin, range_end] : labelRanges(text)) {
+			const auto range_size{ range_end - range_begin };
+			const auto first_task{ chunks.size() };
+
+			chunks.resize(first_task + workerCount(range_size, min_bytes_per_task));
+
+			parallelFor(range_size, min_bytes_per_task, [&, range_begin = range_begin](size_t task, size_t begin, size_t end) {
+				parseChunk(text, range_begin + begin, range_begin + end, chunks[first_task + task]);
+			});
+		}
+
+		// the first chunk is taken over as it is, which for files parsed by one thread is all of them
+		std::vector<uint32_t> hashes{};
+
+		for (auto& chunk : chunks) {
+			if (symbols.empty()) {
+				names = std::move(chunk.names);
+				symbols = std::move(chunk.symbols);
+				hashes = std::move(chunk.hashes);
+				continue;
+			}
+
+			const auto name_base{ static_cast<uint32_t>(names.size()) };
+
+			names.insert(names.end(), chunk.names.begin(), chunk.names.end());
+			hashes.insert(hashes.end(), chunk.hashes.begin(), chunk.hashes.end());
+
+			for (auto symbol : chunk.symbols) {
+				symbol.name_offset += name_base;
+				symbols.push_back(symbol);
+			}
+		}
+
+		slots.resize(std::bit_ceil(std::max<size_t>(symbols.size() * 2, 16)));
+
+		std::vector<std::pair<uint32_t, uint32_t>> duplicates{};
+
+		for (uint32_t symbol{ 0 }; symbol != symbols.size(); ++symbol) {
+#if defined(BINARY_FILE_SSE2)
+			// the slots span megabytes, so fetch the ones a few labels ahead while this one is inserted
+			if (symbol + prefetch_distance < hashes.size()) {
+				_mm_prefetch(reinterpret_cast<const char*>(
+					&slots[hashes[symbol + prefetch_distance] & (slots.size() - 1)]
+				), _MM_HINT_T0);
+			}
+#endif
+			if (const auto owner{ insert(symbol, hashes[symbol]) }; owner != symbol) {
+				duplicates.emplace_back(symbol, owner);
+			}
+		}
+
+		if (!duplicates.empty()) {
+			shareNames(duplicates);
+		}
+
+		// stable LSD radix sort on the 24-bit address in two 12-bit passes, the first one walks the
+		// symbols in order into the hashes, which aren't needed anymore, and the second lands back in
+		// by_address
+		auto& order{ hashes };
+		by_address.resize(symbols.size());
+
+		std::vector<size_t> low_offsets(radix_size + 1);
+		std::vector<size_t> high_offsets(radix_size + 1);
+
+		for (const auto& symbol : symbols) {
+			++low_offsets[(symbol.snes_address & radix_mask) + 1];
+			++high_offsets[(symbol.snes_address >> radix_bits) + 1];
+		}
+
+		for (size_t digit{ 1 }; digit != radix_size + 1; ++digit) {
+			low_offsets[digit] += low_offsets[digit - 1];
+			high_offsets[digit] += high_offsets[digit - 1];
+		}
+
+		for (uint32_t symbol{ 0 }; symbol != symbols.size(); ++symbol) {
+			order[low_offsets[symbols[symbol].snes_address & radix_mask]++] = symbol;
+		}
+
+		for (const auto symbol : order) {
+			by_address[high_offsets[symbols[symbol].snes_address >> radix_bits]++] = symbol;
+		}
+	}
+
+	// a chunk parses every line that starts inside it
+	void SymbolTable::parseChunk(std::string_view text, size_t begin, size_t end, Chunk& chunk) {
+		// names can't take up more than the lines holding them
+		chunk.names.reserve(end - begin);
+		chunk.symbols.reserve((end - begin) / expected_line_length);
+		chunk.hashes.reserve((end - begin) / expected_line_length);
+
+		if (begin != 0 && text[begin - 1] != '\n') {
+			const auto next_line{ text.find('\n', begin) };
+
+			if (next_line == std::string_view::npos) {
+				return;
+			}
+
+			begin = next_line + 1;
+		}
+
+		const auto text_end{ text.data() + text.size() };
+
+		while (begin < end) {
+			std::string_view name{};
+			uint32_t snes_address{ 0 };
+
+			const auto stopped{ static_cast<size_t>(parseLine(text.data() + begin, text_end, name, snes_address) - text.data()) };
+
+			if (!name.empty()) {
+				chunk.symbols.push_back({ static_cast<uint32_t>(chunk.names.size()), static_cast<uint32_t>(name.size()), snes_address });
+				chunk.hashes.push_back(hashLabel(name));
+				chunk.names.insert(chunk.names.end(), name.begin(), name.end());
+			}
+
+			if (stopped != text.size() && text[stopped] == '\n') {
+				begin = stopped + 1;
+				continue;
+			}
+
+			const auto line_end{ text.find('\n', stopped) };
+
+			if (line_end == std::string_view::npos) {
+				return;
+			}
+
+			begin = line_end + 1;
+		}
+	}
+
+	std::optional<size_t> SymbolTable::find(std::string_view label) const {
+		const auto symbol{ lookup(label, hashLabel(label)) };
+
+		if (symbol == nullptr) {
+			return std::nullopt;
+		}
+
+		return symbol->snes_address;
+	}
+
+	std::optional<Address> SymbolTable::find(std::string_view label, Rom& rom) const {
+		const auto snes_address{ find(label) };
+
+		if (!snes_address.has_value()) {
+			return std::nullopt;
+		}
+
+		return rom.snes(snes_address.value());
+	}
+
+	std::vector<std::string_view> SymbolTable::labelsAt(size_t snes_address) const {
+		const auto first{ std::lower_bound(by_address.begin(), by_address.end(), snes_address,
+			[this](uint32_t symbol, size_t value) { return symbols[symbol].snes_address < value; }
+		) };
+		const auto last{ std::upper_bound(first, by_address.end(), snes_address,
+			[this](size_t value, uint32_t symbol) { return value < symbols[symbol].snes_address; }
+		) };
+
+		std::vector<std::string_view> labels{};
+
+		for (auto symbol{ first }; symbol != last; ++symbol) {
+			labels.push_back(nameOf(symbols[*symbol]));
+		}
+
+		return labels;
+	}
+
+	std::vector<std::string_view> SymbolTable::labelsAt(const Address& address) const {
+		return labelsAt(address.snes());
+	}
+
+	size_t SymbolTable::getSize() const {
+		return symbols.size();
+	}
+
+	std::string_view SymbolTable::nameOf(const Symbol& symbol) const {
+		return { names.data() + symbol.name_offset, symbol.name_length };
+	}
+
+	const SymbolTable::Symbol* SymbolTable::lookup(std::string_view label, uint32_t hash) const {
+		const auto mask{ slots.size() - 1 };
+
+		for (auto slot{ hash & mask }; slots[slot].symbol != 0; slot = (slot + 1) & mask) {
+			if (slots[slot].hash == hash && nameOf(symbols[slots[slot].symbol - 1]) == label) {
+				return &symbols[slots[slot].symbol - 1];
+			}
+		}
+
+		return nullptr;
+	}
+
+	// a label defined twice keeps its first address for lookups, but both show up in labelsAt
+	uint32_t SymbolTable::insert(uint32_t symbol, uint32_t hash) {
+		const auto label{ nameOf(symbols[symbol]) };
+		const auto mask{ slots.size() - 1 };
+		auto slot{ hash & mask };
+
+		for (; slots[slot].symbol != 0; slot = (slot + 1) & mask) {
+			if (slots[slot].hash == hash && nameOf(symbols[slots[slot].symbol - 1]) == label) {
+				return slots[slot].symbol - 1;
+			}
+		}
+
+		slots[slot] = { hash, symbol + 1 };
+		return symbol;
+	}
+
+	// names are in the pool in symbol order, so one pass moves every first definition's name down
+	// over the copies the later definitions brought along, which then point at the kept one
+	void SymbolTable::shareNames(const std::vector<std::pair<uint32_t, uint32_t>>& duplicates) {
+		auto duplicate{ duplicates.begin() };
+		uint32_t kept{ 0 };
+
+		for (uint32_t symbol{ 0 }; symbol != symbols.size(); ++symbol) {
+			auto& entry{ symbols[symbol] };
+
+			if (duplicate != duplicates.end() && duplicate->first == symbol) {
+				entry.name_offset = symbols[duplicate->second].name_offset;
+				++duplicate;
+				continue;
+			}
+
+			std::memmove(names.data() + kept, names.data() + entry.name_offset, entry.name_length);
+			entry.name_offset = kept;
+			kept += entry.name_length;
+		}
+
+		names.resize(kept);
+	}
+}
@@ -0,0 +1,402 @@
+#include "../include/text_table.h"
+
+#include <algorithm>
+
+#include "../include/libstr.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t escape_length{ 4 };
+		constexpr size_t min_strings_per_task{ 256 };
+
+		byte hexValue(unsigned char c) {
+			return is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+		}
+
+		bool isEscape(std::string_view text, size_t position) {
+			return position + escape_length <= text.size() && text[position] == '[' &&
+				is_xdigit(text[position + 1]) && is_xdigit(text[position + 2]) && text[position + 3] == ']';
+		}
+
+		std::span<const byte> bytesOf(std::string_view text) {
+			return { reinterpret_cast<const byte*>(text.data()), text.size() };
+		}
+	}
+
+	void TextTable::Trie::insert(std::span<const byte> key, uint32_t entry) {
+		uint32_t node{ 0 };
+
+		for (const auto value : key) {
+			const auto existing{ building[node].find(value) };
+
+			if (existing != building[node].end()) {
+				node = existing->second;
+				continue;
+			}
+
+			const auto created{ static_cast<uint32_t>(building.size()) };
+			building.emplace_back();
+			building_entries.push_back(no_entry);
+
+			building[node][value] = created;
+			node = created;
+		}
+
+		// the first entry for a key wins
+		if (building_entries[node] == no_entry) {
+			building_entries[node] = entry;
+		}
+	}
+
+	void TextTable::Trie::compile() {
+		nodes.resize(building.size());
+
+		for (size_t node{ 0 }; node != building.size(); ++node) {
+			nodes[node] = { static_cast<uint32_t>(edge_bytes.size()), static_cast<uint32_t>(building[node].size()), building_entries[node] };
+
+			for (const auto& [value, target] : building[node]) {
+				edge_bytes.push_back(value);
+				edge_targets.push_back(target);
+			}
+		}
+
+		for (const auto& [value, target] : building.front()) {
+			root_edges[value] = target;
+		}
+
+		building.clear();
+		building_entries.clear();
+	}
+
+	std::optional<std::pair<uint32_t, size_t>> TextTable::Trie::longestMatch(std::span<const byte> input) const {
+		std::optional<std::pair<uint32_t, size_t>> match{};
+
+		if (input.empty()) {
+			return match;
+		}
+
+		// the root never is a child, so 0 doubles as no edge
+		auto node{ root_edges[input.front()] };
+		size_t length{ 1 };
+
+		while (node != 0) {
+			if (nodes[node].entry != no_entry) {
+				match = { nodes[node].entry, length };
+			}
+
+			if (length == input.size()) {
+				break;
+			}
+
+			node = child(node, input[length++]);
+		}
+
+		return match;
+	}
+
+	uint32_t TextTable::Trie::child(uint32_t node, byte value) const {
+		const auto first{ edge_bytes.begin() + nodes[node].first_edge };
+		const auto last{ first + nodes[node].edge_count };
+		const auto edge{ std::lower_bound(first, last, value) };
+
+		return edge != last && *edge == value ? edge_targets[edge - edge_bytes.begin()] : 0;
+	}
+
+	TextTable::TextTable(const fs::path& path) {
+		if (!fs::is_regular_file(path)) {
+			throw TableFileException(fmt::format(
+				"Table file {} does not exist or is not a regular file",
+				path.string()
+			));
+		}
+
+		const MappedFile file{ path };
+		auto text{ file.getText() };
+
+		if (text.starts_with("\xEF\xBB\xBF")) {
+			text.remove_prefix(3);
+		}
+
+		size_t line_number{ 1 };
+		while (!text.empty()) {
+			const auto line_end{ std::min(text.find('\n'), text.size()) };
+			auto line{ text.substr(0, line_end) };
+
+			if (line.ends_with('\r')) {
+				line.remove_suffix(1);
+			}
+
+			if (!line.empty()) {
+				addLine(line, line_number, path);
+			}
+
+			text.remove_prefix(std::min(line_end + 1, text.size()));
+			++line_number;
+		}
+
+		decoder.compile();
+		encoder.compile();
+	}
+
+	void TextTable::addLine(std::string_view line, size_t line_number, const fs::path& path) {
+		auto kind{ EntryKind::TEXT };
+
+		if (line.front() == '/') {
+			kind = EntryKind::END;
+			line.remove_prefix(1);
+		}
+		else if (line.front() == '*') {
+			kind = EntryKind::LINE_BREAK;
+			line.remove_prefix(1);
+		}
+
+		const auto separator{ line.find('=') };
+		const auto hex{ line.substr(0, separator) };
+		auto text{ separator == std::string_view::npos ? std::string_view{} : line.substr(separator + 1) };
+
+		if (hex.empty() || hex.size() % 2 != 0 || !std::all_of(hex.begin(), hex.end(), [](char c) { return is_xdigit(c); }) ||
+			(kind == EntryKind::TEXT && separator == std::string_view::npos)) {
+			throw TableFileException(fmt::format(
+				"{}:{}: invalid table entry '{}'",
+				path.string(), line_number, line
+			));
+		}
+
+		if (kind == EntryKind::LINE_BREAK && text.empty()) {
+			text = "\n";
+		}
+
+		Entry entry{ {}, std::string(text), kind };
+		for (size_t i{ 0 }; i != hex.size(); i += 2) {
+			entry.code.push_back(hexValue(hex[i]) << 4 | hexValue(hex[i + 1]));
+		}
+
+		const auto index{ static_cast<uint32_t>(entries.size()) };
+
+		decoder.insert(entry.code, index);
+		if (!entry.text.empty()) {
+			encoder.insert(bytesOf(entry.text), index);
+		}
+
+		if (kind == EntryKind::END && !end_entry.has_value()) {
+			end_entry = index;
+		}
+
+		entries.push_back(std::move(entry));
+	}
+
+	std::string TextTable::decode(std::span<const byte> bytes, size_t* consumed) const {
+		std::string text{};
+
+		size_t position{ 0 };
+		while (position != bytes.size()) {
+			const auto match{ decoder.longestMatch(bytes.subspan(position)) };
+
+			if (!match.has_value()) {
+				text += fmt::format("[{:02X}]", bytes[position++]);
+				continue;
+			}
+
+			const auto& entry{ entries[match->first] };
+
+			text += entry.text;
+			position += match->second;
+
+			if (entry.kind == EntryKind::END) {
+				break;
+			}
+		}
+
+		if (consumed != nullptr) {
+			*consumed = position;
+		}
+
+		return text;
+	}
+
+	std::vector<byte> TextTable::encode(std::string_view text) const {
+		std::vector<byte> encoded{};
+
+		size_t position{ 0 };
+		while (position != text.size()) {
+			const auto match{ encoder.longestMatch(bytesOf(text.substr(position))) };
+
+			if ((!match.has_value() || match->second < escape_length) && isEscape(text, position)) {
+				encoded.push_back(hexValue(text[position + 1]) << 4 | hexValue(text[position + 2]));
+				position += escape_length;
+				continue;
+			}
+
+			if (!match.has_value()) {
+				throw TextEncodingException(fmt::format(
+					"No table entry matches '{}' at position {} of \"{}\"",
+					text.substr(position, 1), position, text
+				));
+			}
+
+			const auto& code{ entries[match->first].code };
+
+			encoded.insert(encoded.end(), code.begin(), code.end());
+			position += match->second;
+		}
+
+		return encoded;
+	}
+
+	std::optional<std::vector<byte>> TextTable::getEndToken() const {
+		if (!end_entry.has_value()) {
+			return std::nullopt;
+		}
+
+		return entries[end_entry.value()].code;
+	}
+
+	std::vector<std::string> TextTable::extract(Rom& rom, const PointerTable& table) const {
+		if (table.pointer_size != 2 && table.pointer_size != 3) {
+			throw BinaryFileException(fmt::format(
+				"Pointers must be 2 or 3 bytes, not {}",
+				table.pointer_size
+			));
+		}
+
+		// without either, a pointer to anything but text decodes the rest of the rom
+		if (!end_entry.has_value() && !table.max_length.has_value()) {
+			throw BinaryFileException(fmt::format(
+				"Cannot extract the strings of the table at {} with a text table that has no end token "
+				"unless the table gives a maximum length",
+				table.address.string()
+			));
+		}
+
+		rom.ensureMapper();
+
+		const auto mapper{ rom.getMapper().value() };
+		const auto sa1_banks{ rom.getSa1Banks() };
+		const auto bank{ table.bank.has_value() ? table.bank.value() : table.address.snes() >> 16 };
+		const auto pointers{ rom.readRange(table.address, table.count * table.pointer_size) };
+		const auto view{ rom.getView() };
+
+		std::vector<std::string> strings(table.count);
+
+		parallelFor(table.count, min_strings_per_task, [&](size_t, size_t begin, size_t end) {
+			for (auto i{ begin }; i != end; ++i) {
+				const auto pointer{ &pointers[i * table.pointer_size] };
+				const auto target{ table.pointer_size == 3 ?
+					static_cast<size_t>(pointer[0] | pointer[1] << 8 | pointer[2] << 16) :
+					static_cast<size_t>(pointer[0] | pointer[1] << 8 | bank << 16) };
+
+				const auto address{ Address::SNES(target, mapper, sa1_banks) };
+
+				if (!address.hasPc() || address.pc() >= view.size()) {
+					throw BinaryFileException(fmt::format(
+						"Pointer {} of the table at {} points to {}, which is outside the ROM",
+						i, table.address.string(), address.string()
+					));
+				}
+
+				const auto available{ view.size() - address.pc() };
+
+				strings[i] = decode(view.subspan(address.pc(), std::min(available, table.max_length.value_or(available))));
+			}
+		});
+
+		return strings;
+	}
+
+	void TextTable::insert(Rom& rom, const PointerTable& table, std::span<const std::string> strings,
+		Address text_start, size_t text_capacity) const {
+		if (table.pointer_size != 2 && table.pointer_size != 3) {
+			throw BinaryFileException(fmt::format(
+				"Pointers must be 2 or 3 bytes, not {}",
+				table.pointer_size
+			));
+		}
+
+		if (strings.size() != table.count) {
+			throw BinaryFileException(fmt::format(
+				"Cannot insert {} string(s) into a table of {} pointer(s)",
+				strings.size(), table.count
+			));
+		}
+
+		// strings without an end token can't be told apart again, or read back by the game
+		if (!end_entry.has_value()) {
+			throw BinaryFileException(fmt::format(
+				"Cannot insert strings into the table at {} with a text table that has no end token",
+				table.address.string()
+			));
+		}
+
+		const auto end_token{ getEndToken().value() };
+		std::vector<std::vector<byte>> encoded(strings.size());
+
+		parallelFor(strings.size(), min_strings_per_task, [&](size_t, size_t begin, size_t end) {
+			for (auto i{ begin }; i != end; ++i) {
+				encoded[i] = encode(strings[i]);
+				encoded[i].insert(encoded[i].end(), end_token.begin(), end_token.end());
+			}
+		});
+
+		for (size_t i{ 0 }; i != encoded.size(); ++i) {
+			if (table.max_length.has_value() && encoded[i].size() > table.max_length.value()) {
+				throw BinaryFileException(fmt::format(
+					"String {} encodes to 0x{:X} bytes, but strings of the table at {} are at most 0x{:X}",
+					i, encoded[i].size(), table.address.string(), table.max_length.value()
+				));
+			}
+		}
+
+		std::map<std::vector<byte>, size_t> placed{};
+		std::vector<byte> text_bytes{};
+		std::vector<byte> pointer_bytes{};
+
+		const auto bank{ table.bank.has_value() ? table.bank.value() : table.address.snes() >> 16 };
+
+		for (const auto& string : encoded) {
+			const auto [existing, inserted] { placed.try_emplace(string, text_bytes.size()) };
+
+			if (inserted) {
+				text_bytes.insert(text_bytes.end(), string.begin(), string.end());
+			}
+
+			const auto target{ text_start.snes() + existing->second };
+
+			if (table.pointer_size == 2 && target >> 16 != bank) {
+				throw BinaryFileException(fmt::format(
+					"String at SNES ${:06X} cannot be reached by a 2-byte pointer into bank ${:02X}",
+					target, bank
+				));
+			}
+
+			for (size_t i{ 0 }; i != table.pointer_size; ++i) {
+				pointer_bytes.push_back((target >> (i * 8)) & 0xFF);
+			}
+		}
+
+		if (text_bytes.size() > text_capacity) {
+			throw BinaryFileException(fmt::format(
+				"Encoded text needs 0x{:X} bytes, but only 0x{:X} are available at {}",
+				text_bytes.size(), text_capacity, text_start.string()
+			));
+		}
+
+		// also checks the pointer table is rom before any text is written
+		const auto table_runs{ rom.runsOf(table.address, pointer_bytes.size()) };
+
+		for (const auto& [text_offset, text_run] : rom.runsOf(text_start, text_bytes.size())) {
+			for (const auto& [table_offset, table_run] : table_runs) {
+				if (text_offset < table_offset + table_run && table_offset < text_offset + text_run) {
+					throw BinaryFileException(fmt::format(
+						"Encoded text of 0x{:X} bytes at {} would overlap the pointer table at {}",
+						text_bytes.size(), text_start.string(), table.address.string()
+					));
+				}
+			}
+		}
+
+		rom.writeRange(text_start, text_bytes);
+		rom.writeRange(table.address, pointer_bytes);
+	}
+}
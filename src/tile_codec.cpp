@@ -0,0 +1,211 @@
+#include "../include/tile_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "simd.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t min_tiles_per_task{ 0x2000 };
+		constexpr size_t plane_pair_size{ 16 };
+
+		size_t depthOf(TileFormat format) {
+			switch (format) {
+			case TileFormat::BPP2:
+				return 2;
+
+			case TileFormat::BPP4:
+				return 4;
+
+			case TileFormat::BPP8:
+			case TileFormat::MODE_7:
+			default:
+				return 8;
+			}
+		}
+
+		// planes 0/1 are interleaved per row in the first 16 bytes, 2/3 in the next 16 and so on
+		size_t planeOffset(size_t plane, size_t row) {
+			return (plane >> 1) * plane_pair_size + row * 2 + (plane & 1);
+		}
+
+		void decodeTileScalar(const byte* tile, byte* pixels, size_t depth) {
+			std::memset(pixels, 0, pixels_per_tile);
+
+			for (size_t row{ 0 }; row != 8; ++row) {
+				for (size_t plane{ 0 }; plane != depth; ++plane) {
+					const auto bits{ tile[planeOffset(plane, row)] };
+
+					for (size_t x{ 0 }; x != 8; ++x) {
+						pixels[row * 8 + x] |= ((bits >> (7 - x)) & 1) << plane;
+					}
+				}
+			}
+		}
+
+		void encodeTileScalar(const byte* pixels, byte* tile, size_t depth) {
+			for (size_t row{ 0 }; row != 8; ++row) {
+				for (size_t plane{ 0 }; plane != depth; ++plane) {
+					byte bits{ 0 };
+
+					for (size_t x{ 0 }; x != 8; ++x) {
+						bits |= ((pixels[row * 8 + x] >> plane) & 1) << (7 - x);
+					}
+
+					tile[planeOffset(plane, row)] = bits;
+				}
+			}
+		}
+
+		void decodeTile(const byte* tile, byte* pixels, size_t depth) {
+#if defined(BINARY_FILE_SSE2)
+			const auto bit_masks{ _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128) };
+
+			for (size_t row{ 0 }; row != 8; row += 2) {
+				auto indices{ _mm_setzero_si128() };
+
+				for (size_t plane{ 0 }; plane != depth; ++plane) {
+					const auto planes{ _mm_set_epi64x(
+						static_cast<int64_t>(tile[planeOffset(plane, row + 1)] * 0x0101010101010101u),
+						static_cast<int64_t>(tile[planeOffset(plane, row)] * 0x0101010101010101u)
+					) };
+					const auto set{ _mm_cmpeq_epi8(_mm_and_si128(planes, bit_masks), bit_masks) };
+
+					indices = _mm_or_si128(indices, _mm_and_si128(set, _mm_set1_epi8(static_cast<char>(1 << plane))));
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + row * 8), indices);
+			}
+#else
+			decodeTileScalar(tile, pixels, depth);
+#endif
+		}
+
+		void encodeTile(const byte* pixels, byte* tile, size_t depth) {
+#if defined(BINARY_FILE_SSE2)
+			for (size_t row{ 0 }; row != 8; row += 2) {
+				const auto indices{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + row * 8)) };
+
+				// mirror each row so movemask puts the leftmost pixel in bit 7
+				auto mirrored{ _mm_or_si128(_mm_slli_epi16(indices, 8), _mm_srli_epi16(indices, 8)) };
+				mirrored = _mm_shufflelo_epi16(mirrored, _MM_SHUFFLE(0, 1, 2, 3));
+				mirrored = _mm_shufflehi_epi16(mirrored, _MM_SHUFFLE(0, 1, 2, 3));
+
+				for (size_t plane{ 0 }; plane != depth; ++plane) {
+					const auto bits{ _mm_movemask_epi8(_mm_slli_epi16(mirrored, static_cast<int>(7 - plane))) };
+
+					tile[planeOffset(plane, row)] = static_cast<byte>(bits);
+					tile[planeOffset(plane, row + 1)] = static_cast<byte>(bits >> 8);
+				}
+			}
+#else
+			encodeTileScalar(pixels, tile, depth);
+#endif
+		}
+
+		size_t checkedTileCount(TileFormat format, size_t planar_size, size_t pixel_count) {
+			const auto size{ tileSize(format) };
+
+			if (planar_size % size != 0 || planar_size / size * pixels_per_tile != pixel_count) {
+				throw BinaryFileException(fmt::format(
+					"0x{:X} byte(s) of tile data don't match 0x{:X} pixel(s) at 0x{:X} bytes per tile",
+					planar_size, pixel_count, size
+				));
+			}
+
+			return planar_size / size;
+		}
+	}
+
+	size_t tileSize(TileFormat format) {
+		return depthOf(format) * 8;
+	}
+
+	void decodeTiles(TileFormat format, std::span<const byte> planar, std::span<byte> pixels) {
+		const auto tile_count{ checkedTileCount(format, planar.size(), pixels.size()) };
+
+		if (format == TileFormat::MODE_7) {
+			std::copy(planar.begin(), planar.end(), pixels.begin());
+			return;
+		}
+
+		const auto size{ tileSize(format) };
+		const auto depth{ depthOf(format) };
+
+		parallelFor(tile_count, min_tiles_per_task, [&](size_t, size_t begin, size_t end) {
+			for (auto tile{ begin }; tile != end; ++tile) {
+				decodeTile(planar.data() + tile * size, pixels.data() + tile * pixels_per_tile, depth);
+			}
+		});
+	}
+
+	void encodeTiles(TileFormat format, std::span<const byte> pixels, std::span<byte> planar) {
+		const auto tile_count{ checkedTileCount(format, planar.size(), pixels.size()) };
+
+		if (format == TileFormat::MODE_7) {
+			std::copy(pixels.begin(), pixels.end(), planar.begin());
+			return;
+		}
+
+		const auto size{ tileSize(format) };
+		const auto depth{ depthOf(format) };
+
+		parallelFor(tile_count, min_tiles_per_task, [&](size_t, size_t begin, size_t end) {
+			for (auto tile{ begin }; tile != end; ++tile) {
+				encodeTile(pixels.data() + tile * pixels_per_tile, planar.data() + tile * size, depth);
+			}
+		});
+	}
+
+	std::vector<byte> decodeTiles(const Rom& rom, Address address, size_t tile_count, TileFormat format) {
+		const auto planar{ rom.readRange(address, tile_count * tileSize(format)) };
+		std::vector<byte> pixels(tile_count * pixels_per_tile);
+
+		decodeTiles(format, planar, pixels);
+
+		return pixels;
+	}
+
+	void encodeTiles(Rom& rom, Address address, TileFormat format, std::span<const byte> pixels) {
+		std::vector<byte> planar(pixels.size() / pixels_per_tile * tileSize(format));
+
+		encodeTiles(format, pixels, planar);
+		rom.writeRange(address, planar);
+	}
+
+	namespace detail {
+		void decodeTilesScalar(TileFormat format, std::span<const byte> planar, std::span<byte> pixels) {
+			const auto tile_count{ checkedTileCount(format, planar.size(), pixels.size()) };
+
+			if (format == TileFormat::MODE_7) {
+				std::copy(planar.begin(), planar.end(), pixels.begin());
+				return;
+			}
+
+			const auto size{ tileSize(format) };
+			const auto depth{ depthOf(format) };
+
+			for (size_t tile{ 0 }; tile != tile_count; ++tile) {
+				decodeTileScalar(planar.data() + tile * size, pixels.data() + tile * pixels_per_tile, depth);
+			}
+		}
+
+		void encodeTilesScalar(TileFormat format, std::span<const byte> pixels, std::span<byte> planar) {
+			const auto tile_count{ checkedTileCount(format, planar.size(), pixels.size()) };
+
+			if (format == TileFormat::MODE_7) {
+				std::copy(pixels.begin(), pixels.end(), planar.begin());
+				return;
+			}
+
+			const auto size{ tileSize(format) };
+			const auto depth{ depthOf(format) };
+
+			for (size_t tile{ 0 }; tile != tile_count; ++tile) {
+				encodeTileScalar(pixels.data() + tile * pixels_per_tile, planar.data() + tile * size, depth);
+			}
+		}
+	}
+}
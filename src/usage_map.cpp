@@ -0,0 +1,430 @@
+#include "../include/usage_map.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <optional>
+
+#include "../include/address.h"
+#include "simd.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		constexpr size_t min_blocks_per_task{ 4 };
+		constexpr size_t vector_size{ 16 };
+		constexpr size_t pair_distance{ 2 };
+		constexpr size_t rats_tag_size{ 8 };
+		constexpr size_t header_snes_address{ 0x00FFB0 };
+		constexpr size_t header_size{ 0x50 };
+
+		// REP/SEP, JSR/JSL, RTS/RTL, LDA/STA/STZ in their usual modes, branches, pushes and pulls,
+		// transfers, INC/DEC A, CLC/SEC, LDX/LDY/CMP/AND immediate
+		constexpr auto common_opcodes{ [] {
+			std::array<bool, 256> table{};
+
+			for (const auto opcode : {
+				0xC2, 0xE2, 0x20, 0x22, 0x60, 0x6B, 0xA9, 0xA5, 0xAD, 0x85, 0x8D, 0x8F, 0x64, 0x9C,
+				0xD0, 0xF0, 0x80, 0x90, 0xB0, 0x10, 0x30, 0x48, 0x68, 0x8B, 0xAB, 0x08, 0x28,
+				0xAA, 0xA8, 0x8A, 0x98, 0x1A, 0x3A, 0x18, 0x38, 0xA2, 0xA0, 0xC9, 0x29
+			}) {
+				table[opcode] = true;
+			}
+
+			return table;
+		}() };
+
+		// bit i is set if bytes[i] == value
+		uint32_t equalMask(const byte* bytes, byte value) {
+#if defined(BINARY_FILE_SSE2)
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)),
+				_mm_set1_epi8(static_cast<char>(value))
+			)));
+#else
+			uint32_t mask{ 0 };
+
+			for (size_t i{ 0 }; i != vector_size; ++i) {
+				mask |= static_cast<uint32_t>(bytes[i] == value) << i;
+			}
+
+			return mask;
+#endif
+		}
+
+		// bit i is set if bytes[i] == bytes[i + pair_distance]
+		uint32_t pairMask(const byte* bytes) {
+#if defined(BINARY_FILE_SSE2)
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + pair_distance))
+			)));
+#else
+			uint32_t mask{ 0 };
+
+			for (size_t i{ 0 }; i != vector_size; ++i) {
+				mask |= static_cast<uint32_t>(bytes[i] == bytes[i + pair_distance]) << i;
+			}
+
+			return mask;
+#endif
+		}
+
+		// bit i is set if bytes[i + 1] and bytes[i + 3] could be the high bytes of neighbouring
+		// pointers into $8000-$FFFF, at most 2 apart and not part of 0xFFFF filler
+		bool isPointerWord(const byte* bytes) {
+			const auto high{ bytes[1] };
+			const auto next_high{ bytes[3] };
+
+			return high >= 0x80 && (bytes[0] != 0xFF || high != 0xFF) && (high > next_high ? high - next_high : next_high - high) <= 2;
+		}
+
+		uint32_t pointerMask(const byte* bytes) {
+#if defined(BINARY_FILE_SSE2)
+			const auto low{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)) };
+			const auto high{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 1)) };
+			const auto next_high{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 3)) };
+
+			const auto distance{ _mm_or_si128(_mm_subs_epu8(high, next_high), _mm_subs_epu8(next_high, high)) };
+			const auto close{ _mm_cmpeq_epi8(_mm_min_epu8(distance, _mm_set1_epi8(2)), distance) };
+			const auto filler{ _mm_and_si128(_mm_cmpeq_epi8(low, _mm_set1_epi8(-1)), _mm_cmpeq_epi8(high, _mm_set1_epi8(-1))) };
+
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_andnot_si128(filler, _mm_and_si128(close, high))));
+#else
+			uint32_t mask{ 0 };
+
+			for (size_t i{ 0 }; i != vector_size; ++i) {
+				mask |= static_cast<uint32_t>(isPointerWord(bytes + i)) << i;
+			}
+
+			return mask;
+#endif
+		}
+
+		class FreeRun {
+		public:
+			FreeRun(size_t min_length) : min_length(min_length) {}
+
+			// mask has a bit per byte of the next width bytes, set where the fill byte is, runs
+			// strictly inside the width are too short to matter since min_length is at least 16
+			void track(uint32_t mask, size_t width) {
+				const auto full{ width == 32 ? UINT32_MAX : (uint32_t{ 1 } << width) - 1 };
+
+				if (mask == full) {
+					current += width;
+					return;
+				}
+
+				current += std::countr_one(mask);
+				close();
+				current = std::countl_one(mask << (32 - width));
+			}
+
+			void close() {
+				if (current >= min_length) {
+					total += current;
+					longest = std::max(longest, current);
+				}
+
+				current = 0;
+			}
+
+			size_t getTotal() const {
+				return total;
+			}
+
+			size_t getLongest() const {
+				return longest;
+			}
+
+		private:
+			size_t min_length;
+			size_t current{ 0 };
+			size_t total{ 0 };
+			size_t longest{ 0 };
+		};
+
+		// data bytes after a valid tag at offset, 0 if there is none
+		size_t ratsLength(std::span<const byte> bytes, size_t offset) {
+			if (bytes.size() - offset < rats_tag_size || bytes[offset + 1] != 'T' || bytes[offset + 2] != 'A' || bytes[offset + 3] != 'R') {
+				return 0;
+			}
+
+			const auto size{ static_cast<size_t>(bytes[offset + 4] | bytes[offset + 5] << 8) };
+			const auto complement{ static_cast<size_t>(bytes[offset + 6] | bytes[offset + 7] << 8) };
+
+			return (size ^ complement) == 0xFFFF ? size + 1 : 0;
+		}
+
+		struct RatsTag {
+			size_t offset;
+			size_t length;
+		};
+
+		BlockStats analyzeBlock(std::span<const byte> bytes, size_t begin, size_t end, const UsageHeuristics& heuristics,
+			std::vector<RatsTag>& tags) {
+			const auto min_free_run{ std::max<size_t>(heuristics.min_free_run, vector_size) };
+
+			std::array<std::array<uint32_t, 256>, 4> histograms{};
+			FreeRun zero_run{ min_free_run };
+			FreeRun ff_run{ min_free_run };
+
+			size_t pairs{ 0 };
+			size_t repeats{ 0 };
+			std::array<size_t, 2> pointer_words{};
+			std::array<size_t, 2> pointer_candidates{};
+			size_t rats_tags{ 0 };
+
+			const auto data{ bytes.data() };
+
+			const auto rats{ [&](size_t offset) {
+				if (const auto length{ ratsLength(bytes, offset) }) {
+					tags.push_back({ offset, length });
+					++rats_tags;
+				}
+			} };
+
+			auto offset{ begin };
+
+			// the pointer check looks 3 bytes ahead, the pair check 2
+			for (; offset + vector_size + 3 <= end; offset += vector_size) {
+				const auto zeroes{ equalMask(data + offset, 0x00) };
+				const auto both_zero{ zeroes & equalMask(data + offset + pair_distance, 0x00) };
+
+				zero_run.track(zeroes, vector_size);
+				ff_run.track(equalMask(data + offset, 0xFF), vector_size);
+
+				pairs += vector_size - std::popcount(both_zero);
+				repeats += std::popcount(pairMask(data + offset) & ~both_zero);
+
+				// blocks start at a multiple of 16, so bit parity is offset parity
+				const auto pointers{ pointerMask(data + offset) };
+				pointer_words[0] += std::popcount(pointers & 0x5555u);
+				pointer_words[1] += std::popcount(pointers & 0xAAAAu);
+				pointer_candidates[0] += vector_size / 2;
+				pointer_candidates[1] += vector_size / 2;
+
+				for (auto candidates{ equalMask(data + offset, 'S') }; candidates != 0; candidates &= candidates - 1) {
+					rats(offset + std::countr_zero(candidates));
+				}
+
+				for (size_t i{ 0 }; i != vector_size; i += 4) {
+					++histograms[0][data[offset + i]];
+					++histograms[1][data[offset + i + 1]];
+					++histograms[2][data[offset + i + 2]];
+					++histograms[3][data[offset + i + 3]];
+				}
+			}
+
+			for (; offset != end; ++offset) {
+				zero_run.track(data[offset] == 0x00, 1);
+				ff_run.track(data[offset] == 0xFF, 1);
+
+				if (offset + pair_distance < end && (data[offset] != 0 || data[offset + pair_distance] != 0)) {
+					++pairs;
+					repeats += data[offset] == data[offset + pair_distance];
+				}
+
+				if (offset + 3 < end) {
+					++pointer_candidates[offset & 1];
+					pointer_words[offset & 1] += isPointerWord(data + offset);
+				}
+
+				if (data[offset] == 'S') {
+					rats(offset);
+				}
+
+				++histograms[offset & 3][data[offset]];
+			}
+
+			zero_run.close();
+			ff_run.close();
+
+			BlockStats stats{};
+			stats.pc_offset = begin;
+			stats.length = end - begin;
+
+			size_t opcodes{ 0 };
+			for (size_t value{ 0 }; value != 256; ++value) {
+				stats.histogram[value] = histograms[0][value] + histograms[1][value] + histograms[2][value] + histograms[3][value];
+
+				if (stats.histogram[value] != 0) {
+					const auto probability{ static_cast<double>(stats.histogram[value]) / stats.length };
+					stats.entropy -= probability * std::log2(probability);
+				}
+
+				if (common_opcodes[value]) {
+					opcodes += stats.histogram[value];
+				}
+			}
+
+			stats.zero_run_bytes = zero_run.getTotal();
+			stats.ff_run_bytes = ff_run.getTotal();
+			stats.longest_free_run = std::max(zero_run.getLongest(), ff_run.getLongest());
+			stats.rats_tags = rats_tags;
+			stats.opcode_share = static_cast<double>(opcodes) / stats.length;
+			stats.row_repeat_share = pairs == 0 ? 0.0 : static_cast<double>(repeats) / pairs;
+
+			for (size_t parity{ 0 }; parity != 2; ++parity) {
+				if (pointer_candidates[parity] != 0) {
+					stats.pointer_share = std::max(stats.pointer_share, static_cast<double>(pointer_words[parity]) / pointer_candidates[parity]);
+				}
+			}
+
+			return stats;
+		}
+
+		BlockUsage classify(const BlockStats& stats, const UsageHeuristics& heuristics) {
+			if (stats.getFreeBytes() >= heuristics.free_share * stats.length) {
+				return BlockUsage::FREE;
+			}
+
+			if (stats.pointer_share >= heuristics.pointer_share) {
+				return BlockUsage::POINTERS;
+			}
+
+			if (stats.opcode_share >= heuristics.opcode_share) {
+				return BlockUsage::CODE;
+			}
+
+			if (stats.row_repeat_share >= heuristics.row_repeat_share) {
+				return BlockUsage::GRAPHICS;
+			}
+
+			if (stats.entropy >= heuristics.compressed_entropy) {
+				return BlockUsage::COMPRESSED;
+			}
+
+			return BlockUsage::DATA;
+		}
+
+		std::string blockJson(const BlockStats& stats, std::optional<size_t> snes_address, bool include_histograms) {
+			auto json{ fmt::format(
+				"{{\"pc\":{},\"length\":{},\"usage\":\"{}\",\"entropy\":{:.3f},\"free_bytes\":{},\"zero_run_bytes\":{},"
+				"\"ff_run_bytes\":{},\"longest_free_run\":{},\"rats_tags\":{},\"rats_bytes\":{},\"contains_header\":{},"
+				"\"pointer_share\":{:.3f},\"opcode_share\":{:.3f},\"row_repeat_share\":{:.3f}",
+				stats.pc_offset, stats.length, usageName(stats.usage), stats.entropy, stats.getFreeBytes(), stats.zero_run_bytes,
+				stats.ff_run_bytes, stats.longest_free_run, stats.rats_tags, stats.rats_bytes, stats.contains_header,
+				stats.pointer_share, stats.opcode_share, stats.row_repeat_share
+			) };
+
+			if (snes_address.has_value()) {
+				json += fmt::format(",\"snes\":\"{:06X}\"", snes_address.value());
+			}
+
+			if (include_histograms) {
+				json += fmt::format(",\"histogram\":[{}]", fmt::join(stats.histogram, ","));
+			}
+
+			return json + "}";
+		}
+	}
+
+	size_t BlockStats::getFreeBytes() const {
+		return zero_run_bytes + ff_run_bytes;
+	}
+
+	std::string_view usageName(BlockUsage usage) {
+		switch (usage) {
+		case BlockUsage::FREE:
+			return "free";
+
+		case BlockUsage::POINTERS:
+			return "pointers";
+
+		case BlockUsage::CODE:
+			return "code";
+
+		case BlockUsage::GRAPHICS:
+			return "graphics";
+
+		case BlockUsage::COMPRESSED:
+			return "compressed";
+
+		case BlockUsage::DATA:
+		default:
+			return "data";
+		}
+	}
+
+	UsageMap analyzeUsage(std::span<const byte> bytes, Mapper mapper, Sa1Banks sa1_banks, const UsageHeuristics& heuristics) {
+		const auto block_count{ (bytes.size() + UsageMap::block_size - 1) / UsageMap::block_size };
+
+		std::vector<BlockStats> blocks(block_count);
+		std::vector<std::vector<RatsTag>> partial_tags(workerCount(block_count, min_blocks_per_task));
+
+		parallelFor(block_count, min_blocks_per_task, [&](size_t task, size_t begin, size_t end) {
+			for (auto block{ begin }; block != end; ++block) {
+				const auto offset{ block * UsageMap::block_size };
+
+				blocks[block] = analyzeBlock(bytes, offset, std::min(offset + UsageMap::block_size, bytes.size()),
+					heuristics, partial_tags[task]);
+			}
+		});
+
+		// a tag's data may run on into the following blocks
+		for (const auto& tags : partial_tags) {
+			for (const auto& tag : tags) {
+				const auto end{ std::min(tag.offset + rats_tag_size + tag.length, bytes.size()) };
+
+				for (auto offset{ tag.offset }; offset < end;) {
+					auto& block{ blocks[offset / UsageMap::block_size] };
+					const auto covered{ std::min(block.pc_offset + block.length, end) - offset };
+
+					block.rats_bytes += covered;
+					offset += covered;
+				}
+			}
+		}
+
+		const auto header{ Address::SNES(header_snes_address, mapper, sa1_banks) };
+		if (header.hasPc() && header.pc() + header_size <= bytes.size()) {
+			blocks[header.pc() / UsageMap::block_size].contains_header = true;
+		}
+
+		UsageMap usage_map{ mapper, sa1_banks, {}, {} };
+
+		for (auto& block : blocks) {
+			block.usage = classify(block, heuristics);
+
+			const auto address{ Address::PC(block.pc_offset, mapper, sa1_banks) };
+
+			if (address.hasSnes()) {
+				usage_map.banks[address.snes() >> 16].push_back(block);
+			}
+			else {
+				usage_map.unmapped_blocks.push_back(block);
+			}
+		}
+
+		return usage_map;
+	}
+
+	std::string UsageMap::toJson(bool include_histograms) const {
+		std::string json{ fmt::format(
+			"{{\"mapper\":\"{}\",\"block_size\":{},\"banks\":[",
+			mapperName(mapper), block_size
+		) };
+
+		bool first_bank{ true };
+		for (const auto& [bank, blocks] : banks) {
+			json += fmt::format("{}{{\"bank\":\"{:02X}\",\"blocks\":[", first_bank ? "" : ",", bank);
+			first_bank = false;
+
+			for (size_t i{ 0 }; i != blocks.size(); ++i) {
+				const auto address{ Address::PC(blocks[i].pc_offset, mapper, sa1_banks) };
+				json += (i == 0 ? "" : ",") + blockJson(blocks[i], address.snes(), include_histograms);
+			}
+
+			json += "]}";
+		}
+
+		json += "],\"unmapped\":[";
+
+		for (size_t i{ 0 }; i != unmapped_blocks.size(); ++i) {
+			json += (i == 0 ? "" : ",") + blockJson(unmapped_blocks[i], std::nullopt, include_histograms);
+		}
+
+		return json + "]}";
+	}
+}
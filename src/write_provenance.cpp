@@ -0,0 +1,150 @@
+#include "../include/write_provenance.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
+
+#include "fmt/format.h"
+
+namespace binary_file {
+	void WriteProvenance::setOwner(std::string_view owner) {
+		const auto existing{ std::find(owners.begin(), owners.end(), owner) };
+
+		if (existing != owners.end()) {
+			current_owner = static_cast<uint16_t>(existing - owners.begin() + 1);
+			return;
+		}
+
+		if (owners.size() == std::numeric_limits<uint16_t>::max()) {
+			throw BinaryFileException(fmt::format(
+				"Cannot track writes from more than {} owners",
+				owners.size()
+			));
+		}
+
+		owners.emplace_back(owner);
+		current_owner = static_cast<uint16_t>(owners.size());
+	}
+
+	const std::string& WriteProvenance::getOwner() const {
+		return owners[current_owner - 1];
+	}
+
+	void WriteProvenance::record(size_t offset, size_t length) {
+		if (length == 0) {
+			return;
+		}
+
+		const auto end{ offset + length };
+		auto run{ firstRunAfter(runs, offset) };
+
+		std::optional<std::pair<size_t, Run>> right{};
+
+		for (auto overlapping{ run }; overlapping != runs.end() && overlapping->first < end; ++overlapping) {
+			const auto& [run_start, run_value] { *overlapping };
+
+			if (run_value.owner != current_owner) {
+				const auto overlap_start{ std::max(run_start, offset) };
+				addConflict(overlap_start, std::min(run_value.end, end) - overlap_start, run_value.owner);
+			}
+
+			if (run_value.end > end) {
+				right = { end, { run_value.end, run_value.owner } };
+			}
+		}
+
+		// a run starting before offset keeps its start and node, so writes continuing a run of the
+		// same owner only move its end
+		if (run != runs.end() && run->first < offset) {
+			run->second.end = offset;
+			++run;
+		}
+
+		while (run != runs.end() && run->first < end) {
+			run = runs.erase(run);
+		}
+
+		auto stop{ end };
+
+		if (right.has_value() && right->second.owner != current_owner) {
+			run = runs.emplace_hint(run, right.value());
+		}
+		else if (right.has_value()) {
+			stop = right->second.end;
+		}
+		else if (run != runs.end() && run->first == end && run->second.owner == current_owner) {
+			stop = run->second.end;
+			run = runs.erase(run);
+		}
+
+		if (run != runs.begin() && std::prev(run)->second.end == offset && std::prev(run)->second.owner == current_owner) {
+			std::prev(run)->second.end = stop;
+		}
+		else {
+			runs.emplace_hint(run, offset, Run{ stop, current_owner });
+		}
+	}
+
+	std::vector<WriteRecord> WriteProvenance::ownersOf(size_t offset, size_t length) const {
+		std::vector<WriteRecord> records{};
+
+		if (length == 0) {
+			return records;
+		}
+
+		const auto end{ offset + length };
+
+		for (auto run{ firstRunAfter(runs, offset) }; run != runs.end() && run->first < end; ++run) {
+			const auto start{ std::max(run->first, offset) };
+			records.push_back({ start, std::min(run->second.end, end) - start, owners[run->second.owner - 1] });
+		}
+
+		return records;
+	}
+
+	std::vector<WriteConflict> WriteProvenance::getConflicts() const {
+		std::vector<WriteConflict> resolved{};
+		resolved.reserve(conflicts.size());
+
+		for (const auto& conflict : conflicts) {
+			resolved.push_back({
+				conflict.offset,
+				conflict.length,
+				owners[conflict.first_owner - 1],
+				owners[conflict.second_owner - 1]
+			});
+		}
+
+		return resolved;
+	}
+
+	void WriteProvenance::clear() {
+		runs.clear();
+		conflicts.clear();
+	}
+
+	template<typename Runs>
+	auto WriteProvenance::firstRunAfter(Runs& runs, size_t offset) -> decltype(runs.begin()) {
+		auto run{ runs.upper_bound(offset) };
+
+		if (run != runs.begin() && std::prev(run)->second.end > offset) {
+			--run;
+		}
+
+		return run;
+	}
+
+	void WriteProvenance::addConflict(size_t offset, size_t length, uint16_t first_owner) {
+		if (!conflicts.empty()) {
+			auto& last{ conflicts.back() };
+
+			if (last.offset + last.length == offset && last.first_owner == first_owner && last.second_owner == current_owner) {
+				last.length += length;
+				return;
+			}
+		}
+
+		conflicts.push_back({ offset, length, first_owner, current_owner });
+	}
+}
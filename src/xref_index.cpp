@@ -0,0 +1,293 @@
+#include "../include/xref_index.h"
+
+#include <algorithm>
+#include <array>
+
+#include "../include/hash.h"
+#include "parallel.h"
+
+namespace binary_file {
+	namespace {
+		// instruction lengths with 8-bit A and X/Y, immediates grow by one byte when the matching flag is clear
+		constexpr std::array<byte, 256> instruction_lengths{
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // 0x
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // 1x
+			3, 2, 4, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // 2x
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // 3x
+			1, 2, 2, 2, 3, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // 4x
+			2, 2, 2, 2, 3, 2, 2, 2, 1, 3, 1, 1, 4, 3, 3, 4, // 5x
+			1, 2, 3, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // 6x
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // 7x
+			2, 2, 3, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // 8x
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // 9x
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // Ax
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // Bx
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // Cx
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4, // Dx
+			2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4, // Ex
+			2, 2, 2, 2, 3, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4  // Fx
+		};
+
+		constexpr byte op_jsr{ 0x20 };
+		constexpr byte op_jsl{ 0x22 };
+		constexpr byte op_jmp{ 0x4C };
+		constexpr byte op_jml{ 0x5C };
+		constexpr byte op_jmp_indexed{ 0x7C };
+		constexpr byte op_jsr_indexed{ 0xFC };
+		constexpr byte op_rep{ 0xC2 };
+		constexpr byte op_sep{ 0xE2 };
+
+		constexpr byte flag_m{ 0x20 };
+		constexpr byte flag_x{ 0x10 };
+
+		bool isAccumulatorImmediate(byte opcode) {
+			return (opcode & 0x1F) == 0x09;
+		}
+
+		bool isIndexImmediate(byte opcode) {
+			return opcode == 0xA0 || opcode == 0xA2 || opcode == 0xC0 || opcode == 0xE0;
+		}
+
+		// ORA/AND/EOR/ADC/STA/LDA/CMP/SBC long and long,X
+		bool isLongData(byte opcode) {
+			return (opcode & 0x0F) == 0x0F;
+		}
+
+		const std::vector<Xref> no_xrefs{};
+	}
+
+	XrefIndex::XrefIndex(Rom& rom) : rom(rom), mapper(Mapper::NO_ROM), sa1_banks(rom.getSa1Banks()) {
+		rom.ensureMapper();
+		mapper = rom.getMapper().value();
+		refresh();
+	}
+
+	const std::vector<Xref>& XrefIndex::referencesTo(size_t pc_address) const {
+		const auto xrefs{ by_target.find(static_cast<uint32_t>(pc_address)) };
+
+		return xrefs == by_target.end() ? no_xrefs : xrefs->second;
+	}
+
+	const std::vector<Xref>& XrefIndex::referencesTo(Address address) const {
+		return referencesTo(address.pc());
+	}
+
+	void XrefIndex::refresh() {
+		adoptMapping();
+
+		const auto view{ rom.getView() };
+		const auto page_count{ (view.size() + page_size - 1) / page_size };
+
+		std::vector<uint64_t> hashes(page_count);
+
+		parallelFor(page_count, 16, [&](size_t, size_t begin, size_t end) {
+			for (auto page{ begin }; page != end; ++page) {
+				hashes[page] = hash64(view.subspan(page * page_size, std::min(page_size, view.size() - page * page_size)));
+			}
+		});
+
+		std::vector<size_t> changed{};
+
+		for (size_t page{ 0 }; page != std::max(page_count, page_xrefs.size()); ++page) {
+			if (page >= page_count || page >= page_hashes.size() || hashes[page] != page_hashes[page]) {
+				changed.push_back(page);
+			}
+		}
+
+		page_hashes = std::move(hashes);
+		sweep(changed);
+	}
+
+	void XrefIndex::refresh(size_t pc_offset, size_t length) {
+		const auto view{ rom.getView() };
+		const auto page_count{ (view.size() + page_size - 1) / page_size };
+
+		if (length == 0) {
+			return;
+		}
+
+		if (adoptMapping()) {
+			refresh();
+			return;
+		}
+
+		std::vector<size_t> pages{};
+
+		for (auto page{ pc_offset / page_size }; page <= (pc_offset + length - 1) / page_size && page < page_count; ++page) {
+			pages.push_back(page);
+		}
+
+		page_hashes.resize(page_count);
+		for (const auto page : pages) {
+			page_hashes[page] = hash64(view.subspan(page * page_size, std::min(page_size, view.size() - page * page_size)));
+		}
+
+		sweep(pages);
+	}
+
+	size_t XrefIndex::getSize() const {
+		return size;
+	}
+
+	bool XrefIndex::adoptMapping() {
+		rom.ensureMapper();
+
+		if (rom.getMapper().value() == mapper && rom.getSa1Banks() == sa1_banks) {
+			return false;
+		}
+
+		mapper = rom.getMapper().value();
+		sa1_banks = rom.getSa1Banks();
+		page_hashes.clear();
+
+		return true;
+	}
+
+	// pages past the end of the rom just lose their xrefs
+	void XrefIndex::sweep(const std::vector<size_t>& pages) {
+		const auto page_count{ (rom.getSize() + page_size - 1) / page_size };
+
+		for (const auto page : pages) {
+			if (page >= page_xrefs.size()) {
+				continue;
+			}
+
+			for (const auto& stale : page_xrefs[page]) {
+				auto& xrefs{ by_target[stale.target] };
+
+				const auto position{ std::find_if(xrefs.begin(), xrefs.end(), [&](const auto& xref) {
+					return xref.source == stale.xref.source;
+				}) };
+
+				if (position != xrefs.end()) {
+					xrefs.erase(position);
+					--size;
+				}
+
+				if (xrefs.empty()) {
+					by_target.erase(stale.target);
+				}
+			}
+
+			page_xrefs[page].clear();
+		}
+
+		page_xrefs.resize(page_count);
+
+		std::vector<std::vector<PageXref>> swept(pages.size());
+
+		parallelFor(pages.size(), 1, [&](size_t, size_t begin, size_t end) {
+			for (auto i{ begin }; i != end; ++i) {
+				if (pages[i] < page_count) {
+					swept[i] = sweepPage(pages[i]);
+				}
+			}
+		});
+
+		for (size_t i{ 0 }; i != pages.size(); ++i) {
+			for (const auto& found : swept[i]) {
+				by_target[found.target].push_back(found.xref);
+			}
+
+			size += swept[i].size();
+
+			if (pages[i] < page_count) {
+				page_xrefs[pages[i]] = std::move(swept[i]);
+			}
+		}
+	}
+
+	std::vector<XrefIndex::PageXref> XrefIndex::sweepPage(size_t page) const {
+		const auto view{ rom.getView() };
+
+		const auto page_start{ page * page_size };
+		const auto page_end{ std::min(view.size(), page_start + page_size) };
+		const auto base{ Address::PC(page_start, mapper, sa1_banks) };
+
+		std::vector<PageXref> found{};
+
+		if (!base.hasSnes()) {
+			return found;
+		}
+
+		const auto program_bank{ base.snes() & 0xFF0000 };
+
+		bool wide_accumulator{ false };
+		bool wide_index{ false };
+
+		for (auto pc{ page_start }; pc < page_end;) {
+			const auto opcode{ view[pc] };
+			const auto length{ instruction_lengths[opcode] +
+				(wide_accumulator && isAccumulatorImmediate(opcode)) + (wide_index && isIndexImmediate(opcode)) };
+
+			if (pc + length > view.size()) {
+				break;
+			}
+
+			size_t operand{ 0 };
+			for (size_t i{ 1 }; i < static_cast<size_t>(length); ++i) {
+				operand |= static_cast<size_t>(view[pc + i]) << ((i - 1) * 8);
+			}
+
+			std::optional<size_t> target{};
+			XrefKind kind{};
+
+			switch (opcode) {
+			case op_rep:
+				wide_accumulator |= (operand & flag_m) != 0;
+				wide_index |= (operand & flag_x) != 0;
+				break;
+
+			case op_sep:
+				wide_accumulator &= (operand & flag_m) == 0;
+				wide_index &= (operand & flag_x) == 0;
+				break;
+
+			case op_jsr:
+				target = program_bank | operand;
+				kind = XrefKind::JSR;
+				break;
+
+			case op_jmp:
+				target = program_bank | operand;
+				kind = XrefKind::JMP;
+				break;
+
+			case op_jmp_indexed:
+			case op_jsr_indexed:
+				target = program_bank | operand;
+				kind = XrefKind::JUMP_TABLE;
+				break;
+
+			case op_jsl:
+				target = operand;
+				kind = XrefKind::JSL;
+				break;
+
+			case op_jml:
+				target = operand;
+				kind = XrefKind::JML;
+				break;
+
+			default:
+				if (isLongData(opcode)) {
+					target = operand;
+					kind = XrefKind::LONG_DATA;
+				}
+				break;
+			}
+
+			if (target.has_value()) {
+				const auto resolved{ Address::SNES(target.value(), mapper, sa1_banks) };
+
+				if (resolved.hasPc() && resolved.pc() < view.size()) {
+					found.push_back({ static_cast<uint32_t>(resolved.pc()), { Address::PC(pc, mapper, sa1_banks), kind } });
+				}
+			}
+
+			pc += length;
+		}
+
+		return found;
+	}
+}